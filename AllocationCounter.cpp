@@ -0,0 +1,21 @@
+#include "Profiler.cpp"
+
+#ifdef ANTCOLONY_PROFILE
+/*
+	* Replacement of the global operator new counting heap allocations for the profiler.
+	* Lives in its own translation unit: a replacement may be defined only once per program.
+*/
+void *operator new(size_t size) {
+	allocationCount.fetch_add(1, memory_order_relaxed);
+	if (void *p = malloc(size ? size : 1)) return p;
+	throw bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+	free(p);
+}
+#endif
@@ -2,131 +2,151 @@
 #define ANT_CLASS
 
 #include "TSP.h"
-
-constexpr auto PI = (double) 3.1415926535897;
-
-constexpr auto RRR = (double) 6378.388;
-
-class Ant {
+#include "Distance.cpp"
+#include "Random.cpp"
+#include "Tour.cpp"
+#include "LocalSearch.cpp"
+
+/*
+	* The whole colony of ants, stored as parallel arrays instead of one object per ant.
+	* The tours of all the ants live in one contiguous nAnts x nCities block of visiting orders, next to
+	* an equal block of positions that doubles as the visited sets (see Tour). Indices are 16 bits wide
+	* when the instance allows it, 32 otherwise. Cities visited, current city, trail length and random
+	* stream of every ant are in arrays indexed by ant, so a lockstep step over the colony walks them in order.
+*/
+class AntPopulation {
 private:
-	int trailSize;
-	bool euc;
-	vector<int> trail;
-	vector<bool> visited;
+	int nAnts = 0;
+	int nCities = 0;
+	bool narrow = true;
+	vector<uint16_t> smallOrders, smallPositions;	//	nAnts x nCities, row k is ant k
+	vector<int32_t> orders, positions;
+	vector<int> sizes;				//	cities visited by every ant
+	vector<int> current;			//	last city visited by every ant
+	vector<double> lengths;			//	trail length so far, closing edge included once complete
+	vector<Random> randoms;			//	every ant's own random stream
 public:
-	Ant(int tourSize, bool e) : trailSize(tourSize), euc(e) {
-		for (int i = 0; i < tourSize; i++) {
-			visited.push_back(false);
+	AntPopulation() {}
+
+	/*
+		* ants ants on tours of tourSize cities, ant k drawing from Random(seed, k)
+	*/
+	AntPopulation(int ants, int tourSize, uint64_t seed)
+		: nAnts(ants), nCities(tourSize), narrow(tourSize <= 65536),
+		  sizes(ants, 0), current(ants, -1), lengths(ants, 0.0) {
+		if (narrow) {
+			smallOrders.assign((size_t) nAnts * nCities, 0);
+			smallPositions.assign((size_t) nAnts * nCities, 0);
 		}
+		else {
+			orders.assign((size_t) nAnts * nCities, 0);
+			positions.assign((size_t) nAnts * nCities, 0);
+		}
+		for (int k = 0; k < nAnts; k++) randoms.push_back(Random(seed, k));
+	}
+
+	int size() const {
+		return nAnts;
 	}
 
 	/*
-		* A new node i visited by this Ant
+		* Change the colony to ants ants with empty trails. Ants kept go on with their random streams,
+		* new ant k draws from Random(seed, k).
 	*/
-	void visitNode(int node) {
-		if (node != -1) {
-			trail.push_back(node);
-			visited[node] = true;
-		}
+	void resize(int ants, uint64_t seed) {
+		AntPopulation resized(ants, nCities, seed);
+		for (int k = 0; k < min(ants, nAnts); k++) resized.randoms[k] = randoms[k];
+		*this = move(resized);
 	}
 
 	/*
-		* Return true if the index node is visited by this Ant
+		* Ant k visits city. The trail length grows with the new edge, and with the closing one on the last city,
+		* read from d: the distances of the calling thread, a replica on its NUMA node if any.
 	*/
-	bool isVisited(int index) {
-		return visited[index];
+	void visitNode(int k, int city, const DistanceMatrix &d) {
+		if (city == -1) return;
+		size_t base = (size_t) k * nCities;
+		int index = sizes[k];
+		if (index > 0) lengths[k] += d.get(current[k], city);
+		if (narrow) {
+			smallOrders[base + index] = (uint16_t) city;
+			smallPositions[base + city] = (uint16_t) index;
+		}
+		else {
+			orders[base + index] = city;
+			positions[base + city] = index;
+		}
+		sizes[k] = index + 1;
+		current[k] = city;
+		if (index + 1 == nCities) lengths[k] += d.get(city, firstNode(k));
 	}
 
 	/*
-		* Return the trail do by this Ant
+		* Return true if city is visited by ant k
 	*/
-	vector<int> getTrail() {
-		return trail;
+	bool isVisited(int k, int city) const {
+		size_t base = (size_t) k * nCities;
+		int index = narrow ? smallPositions[base + city] : positions[base + city];
+		return index < sizes[k] && (narrow ? smallOrders[base + index] : orders[base + index]) == city;
 	}
 
 	/*
-		* Return the node in the index trail's position
+		* Return the last city visited by ant k
 	*/
-	int getTrailNode(int index) {
-		return trail[index];
+	int lastNode(int k) const {
+		return current[k];
+	}
+
+	int firstNode(int k) const {
+		size_t base = (size_t) k * nCities;
+		return narrow ? smallOrders[base] : orders[base];
 	}
 
 	/*
-		* Return trail's total length
+		* Return true once ant k has visited every city
 	*/
-	double trailLength(vector<pair<double, double>> graph) {
-		double length = distance(graph[trail[0]], graph[trail[trailSize - 1]]);
-		for (int i = 0; i < trailSize - 1; i++) {
-			length += distance(graph[trail[i]], graph[trail[i + 1]]);
-		}
-		return length;
+	bool isComplete(int k) const {
+		return sizes[k] == nCities;
 	}
 
 	/*
-	 * Return 1 if the edge is in the ant's trail.
-	 */
-	bool isEdgeInTrail(int node1, int node2) {
-	    int index = 0;
-        for (int i = 0; i < trailSize; i++) {
-            if(trail[i] == node1) index = i;
-        }
-        if(index == 0) {
-            if(trail[trailSize - 1] == node2) return true;
-        }
-        else if(index == (trailSize - 1)) {
-            if(trail[0] == node2) return true;
-        }
-        else {
-            if(trail[index - 1] == node2 || trail[index + 1] == node2) return true;
-        }
-        return false;
+		* Return the trail length of ant k
+	*/
+	double trailLength(int k) const {
+		return lengths[k];
 	}
 
 	/*
-		* Clear Ant informations
+		* Tour of ant k, a view on the population block valid until the population is destroyed
 	*/
-	void clear() {
-		trail.clear();
-		for (int i = 0; i < trailSize; i++) {
-			visited[i] = false;
-		}
+	Tour getTour(int k) {
+		size_t base = (size_t) k * nCities;
+		if (narrow) return Tour(&smallOrders[base], &smallPositions[base], nCities, sizes[k]);
+		return Tour(&orders[base], &positions[base], nCities, sizes[k]);
+	}
+
+	Random &random(int k) {
+		return randoms[k];
 	}
 
 	/*
-		* Euclidean distance from one node to another. Definition provided by TSP Data uni-heidelberg
+		* Improve the complete trail of ant k with the local search, keeping its length up to date.
+		* Distances are read by search only, give the one of the calling thread.
 	*/
-	double distance(pair<double, double> node1, pair<double, double> node2) {
-        if(euc) {
-            double xd = node1.first - node2.first;
-            double yd = node1.second - node2.second;
-            return (int)(0.5 + sqrt(pow(xd, 2) + pow(yd, 2)));
-        }
-        else{
-            double deg = (int)(node1.first);
-            double min = node1.first - deg;
-            double lat_p1 = PI * (deg + 5.0*min / 3.0) / 180.0;
-
-            deg = (int)(node1.second);
-            min = node1.second - deg;
-            double lon_p1 = PI * (deg + 5.0*min / 3.0) / 180.0;
-
-            deg = (int)(node2.first);
-            min = node2.first - deg;
-            double lat_p2 = PI * (deg + 5.0*min / 3.0) / 180.0;
-
-            deg = (int)(node2.second);
-            min = node2.second - deg;
-            double lon_p2 = PI * (deg + 5.0*min / 3.0) / 180.0;
-
-            double q1 = cos(lon_p1 - lon_p2);
-            double q2 = cos(lat_p1 - lat_p2);
-            double q3 = cos(lat_p1 + lat_p2);
-            double d_p1_p2 = (int)(RRR*acos(0.5*((1.0 + q1)*q2 - (1.0 - q1)*q3)) + 1.0);
-
-            return d_p1_p2;
-        }
+	void improve(int k, LocalSearch &search) {
+		Tour tour = getTour(k);
+		lengths[k] -= search.twoOpt(tour);
+		current[k] = tour.node(nCities - 1);
 	}
 
+	/*
+		* Forget the trail of ant k
+	*/
+	void clear(int k) {
+		sizes[k] = 0;
+		current[k] = -1;
+		lengths[k] = 0.0;
+	}
 };
 
-#endif // !ANT_CLASS
\ No newline at end of file
+#endif // !ANT_CLASS
@@ -1,7 +1,21 @@
+#ifndef ANT_COLONY_CLASS
+#define ANT_COLONY_CLASS
+
 #include "TSP.h"
 #include "Ant.cpp"
-#include "Parser.cpp"
+#include "Problem.cpp"
 #include "Plotter.cpp"
+#include "InitialTour.cpp"
+#include "Profiler.cpp"
+#include "ThreadPool.cpp"
+#include "LocalSearch.cpp"
+#include "Numa.cpp"
+#include "Pheromone.cpp"
+#include "Observer.cpp"
+#include "Checkpoint.cpp"
+#include "SumTree.cpp"
+#include "SpatialGrid.cpp"
+#include "LowerBound.cpp"
 
 //Number of trails at the start of the simulation
 constexpr auto C = (double) 1.0;;
@@ -21,6 +35,54 @@ constexpr auto RANDOMFACTOR = (double) 0.9;;
 //Number of iterations before stop the algorithm
 constexpr auto MAXITERATIONS = (int) 200;;
 
+//Minimum number of pheromone rows handed to a thread
+constexpr auto ROWGRAIN = (int) 16;;
+
+//Minimum number of ants handed to a thread when looking for the iteration best
+constexpr auto REDUCTIONGRAIN = (int) 1024;;
+
+//Distances per node averaged for the minimum pheromone when they are computed on the fly
+constexpr auto AVERAGESAMPLES = (int) 64;;
+
+//Cities an ant visits between two looks at the clock while it builds its tour
+constexpr auto DEADLINESTEPS = (int) 256;;
+
+//Fewest cities for which the automatic sampler draws exploration moves from per-row sum trees
+constexpr auto TREESAMPLERNODES = (int) 500;;
+
+//Most cities for which the automatic sampler builds sum trees
+constexpr auto TREESAMPLERMAXNODES = (int) 4096;;
+
+//Draws from a sum tree allowed to land on visited cities before the linear scan takes over
+constexpr auto TREESAMPLERTRIES = (int) 4;;
+
+//Colony size of the mmas policy, the usual MMAS setting, and of the first iteration of the adaptive one
+constexpr auto MMASANTS = (int) 25;;
+
+//Iterations the adaptive policy sizes the colony to complete within the time budget
+constexpr auto ADAPTIVEITERATIONS = (int) 100;;
+
+//Fewest ants the adaptive policy keeps, local search is then cut down to the iteration best ant
+constexpr auto ADAPTIVEMINANTS = (int) 4;;
+
+//Share of the pheromone range of a node an arc must rise above the row minimum to count in the lambda-branching factor
+constexpr auto LAMBDA = (double) 0.05;;
+
+//Average lambda-branching factor below which MMAS trails count as converged, 2 is a single tour
+constexpr auto STAGNATIONBRANCHING = (double) 2.05;;
+
+//Share of the iteration best edges missing from the best tour, on average, below which the colony walks the same tour
+constexpr auto STAGNATIONDISTANCE = (double) 0.01;;
+
+//Iterations without a better restart best tour before converged MMAS trails are reinitialized
+constexpr auto STAGNATIONITERATIONS = (int) 50;;
+
+//Weight of the last iteration in the running average of the distance between iteration best and best tour
+constexpr auto DISTANCESMOOTHING = (double) 0.1;;
+
+//After a reinitialization MMAS deposits on the restart best tour, and on the best one every GLOBALDEPOSITPERIOD iterations
+constexpr auto GLOBALDEPOSITPERIOD = (int) 5;;
+
 //Is AC algorithm?
 constexpr auto AC = 0;;
 
@@ -30,87 +92,671 @@ constexpr auto ACS = 0;;
 //Is MMAS algorithm?
 constexpr auto MMAS = 1;;
 
+enum ColonySize {
+	PROPORTIONAL_COLONY,
+	MMAS_COLONY,
+	ADAPTIVE_COLONY
+};
+
+/*
+	* Colony size policy named on the command line: proportional, mmas or adaptive
+*/
+inline ColonySize parseColonySize(string name) {
+	if (name.compare("proportional") == 0) return PROPORTIONAL_COLONY;
+	if (name.compare("mmas") == 0) return MMAS_COLONY;
+	if (name.compare("adaptive") == 0) return ADAPTIVE_COLONY;
+	cout << "Unknown colony size " << name << ", use proportional, mmas or adaptive\n";
+	exit(7);
+}
+
+/*
+	* Run-time settings chosen at startup
+*/
+struct SolverOptions {
+	InitialTourType initialTour = NO_INITIAL_TOUR;	//	constructor of the starting best tour
+	double timeLimit = 0.0;							//	seconds available to solve(), 0 means no limit
+	CurveType reorder = NO_CURVE;					//	load-time renumbering of the cities along a curve
+	string tracePath;								//	per-iteration profile trace (.csv or .json), needs ANTCOLONY_PROFILE
+	int maxIterations = MAXITERATIONS;				//	iterations run by solve()
+	int ants = 0;									//	colony size, 0 leaves it to the colony policy
+	ColonySize colony = PROPORTIONAL_COLONY;		//	nNodes * ANTFACTOR ants, MMASANTS, or as many as timeLimit allows
+	bool plot = true;								//	show points and improvements with gnuplot
+	int plotLimit = PLOTLIMIT;						//	most cities drawn per plot, larger tours are downsampled
+	bool verbose = true;							//	print progress on cout
+	uint64_t seed = 0;								//	seed of the random streams, 0 picks one from the clock
+	int threads = 0;								//	worker threads of the process pool, 0 means one per hardware thread
+	bool affinity = false;							//	pin every pool worker to its own CPU
+	bool localSearch = false;						//	improve every ant's tour with 2-opt
+	bool replicate = false;							//	copy distances and neighbor lists to every NUMA node, pins the workers
+	bool sparse = false;							//	keep pheromone only on the neighbor list arcs and build tours on them
+	string checkpointPath;							//	state written when solve() stops, empty for none
+	int checkpointInterval = 0;						//	iterations between checkpoints, 0 writes only when solve() stops
+	string resumePath;								//	checkpoint solve() continues from, empty to start afresh
+	Precision precision = DOUBLE_PRECISION;			//	choice info read while building tours, float halves its bandwidth
+	bool matrixFree = false;						//	compute distances on the fly, always so above MAXMATRIXNODES cities
+	SamplerType sampler = AUTO_SAMPLER;				//	exploration moves by a scan of the row or from sum trees, auto picks by size
+	bool restart = true;							//	reinitialize MMAS trails to maxPheromone once the colony stagnates
+	BoundMode bound = NO_BOUND;						//	Held-Karp lower bound computed before the iterations, alongside them, or not at all
+	double gap = 0.0;								//	stop once the best tour is within this fraction of an exact lower bound, 0 never stops
+	CandidateType candidates = NEAREST_CANDIDATES;	//	neighbor lists by distance, or by alpha-nearness in the lower bound 1-tree
+};
+
 class AntColony {
+	friend class Bench;
 private:
 	int nNodes;
 	int nAnts;
 	bool euc;
-	vector<Ant> ants;					//  Ants vector
+	AntPopulation ants;					//  Tours, positions and random streams of every ant
 	vector<pair<double, double>> nodes;	//  Point vector
-	vector<vector<double>> trails;		//	pheromone in every arc.
-	vector<double> probabilities;		//	probabilities vector going from one node to another
-	int currentIndex;
+	vector<int> originalIds;			//	file index of every node, nodes may be renumbered at load time
+	shared_ptr<const DistanceMatrix> distances;	//	distance between every pair of nodes, shared with the Problem
+	PheromoneStore trails;				//	pheromone in every arc.
+	unique_ptr<SumTree> rowSums;		//	choice info sums of every dense row, only with the tree sampler
+	vector<vector<double>> threadProbabilities;	//	probabilities vector going from one node to another, one per thread
+	vector<LocalSearch> threadSearch;			//	2-opt buffers, one per thread
+	unique_ptr<NeighborLists> neighbors;		//	candidate moves of the local search and candidate arcs of the sparse trails
+	unique_ptr<SpatialGrid> grid;				//	unvisited cities of every ant by cell, sparse EUC trails only
+	unique_ptr<HeldKarpBound> lowerBound;		//	lower bound on the tour length, when a bound or alpha candidates are asked for
+	thread boundThread;							//	runs the ascent of a parallel bound while solve() iterates
+	bool boundStarted = false;					//	the ascent ran or is running, it is not repeated by later solve() calls
+	double ascentSeconds = 0.0;					//	spent by the constructor on the ascent, charged to the next solve()
+	double reportedBound = 0.0;					//	last bound printed
+	bool reportedExact = false;					//	the last bound printed was exact
+	vector<const DistanceMatrix *> threadDistances;		//	distances read by every thread, a replica on its NUMA node if any
+	vector<unique_ptr<DistanceMatrix>> distanceReplicas;	//	one per NUMA node when replicate is set
+	vector<unique_ptr<NeighborLists>> neighborReplicas;
+	ThreadPool *pool;
+	int nThreads;
 
 	double minPheromone;
 	double maxPheromone = DBL_MAX;
-	vector<int> bestTour;
+	Tour bestTour;
 	double bestTourLength = DBL_MAX;
+	double iterationBestLength = DBL_MAX;	//	best complete tour of the last iteration
+	Tour restartBestTour;				//	best tour since the last reinitialization of the trails
+	double restartBestLength = DBL_MAX;
+	int restarts = 0;					//	reinitializations so far
+	int restartIteration = 0;			//	first iteration after the last reinitialization
+	int restartImproved = 0;			//	last iteration that improved the restart best tour
+	double branching = 0.0;				//	average lambda-branching factor of the trails after the last update
+	double averageDistance = 0.0;		//	running average of the iteration best edges missing from the best tour
+	int iteration = 0;
+	int iterationsDone = 0;				//	completed iterations, resumed ones included
+	vector<int> threadBest;				//	best complete ant seen by every thread in the last construction, -1 for none
+	bool improveBestOnly = false;		//	local search on the iteration best tour only, set by the adaptive colony
+	const CancellationToken *cancellation = nullptr;
+
+	string name;
+	vector<SolverObserver *> observers;	//	notified by solve(), not owned
 
-	Plotter chart = Plotter();
+	SolverOptions options;
+	chrono::steady_clock::time_point startTime;
+
+	unique_ptr<Plotter> chart;
+#ifdef ANTCOLONY_PROFILE
+	Profiler profiler;
+#endif
 
 public:
-	AntColony(string file) {
-		Parser p(file);
-		p.parse();
-		nodes = p.getNodes();
-        nNodes = p.getDimension();
-        euc = p.isEuc();
-        cout << "TSP Problem: " << p.getName() << "\n";
-		chart.plotPoints(nodes, nNodes);
-		getchar();
-		srand(time(NULL));
-		nAnts = (int) (nNodes * ANTFACTOR);
+	AntColony(string file, SolverOptions opts = SolverOptions()) : AntColony(load(file, opts), opts) {}
+
+	/*
+		* Colony on an already loaded problem, possibly shared with other colonies
+	*/
+	AntColony(shared_ptr<const Problem> problem, SolverOptions opts = SolverOptions()) : options(opts) {
+		nodes = problem->nodes;
+		originalIds = problem->originalIds;
+        nNodes = problem->size();
+        euc = problem->euc;
+        name = problem->name;
+        distances = problem->distances;
+        if (options.verbose) cout << "TSP Problem: " << name << "\n";
+		if (options.plot) {
+			chart.reset(new Plotter(options.plotLimit));
+			chart->plotPoints(nodes, nNodes);
+			getchar();
+		}
+		if (options.seed == 0) options.seed = (uint64_t) chrono::system_clock::now().time_since_epoch().count();
+		if (options.verbose) cout << "Seed: " << options.seed << "\n";
+		nAnts = initialColonySize();
+		pool = &ThreadPool::shared();
+		nThreads = pool->size();
+		PROFILE_THREADS(nThreads);
+		// Outside ACS every ant is set up within its construction task
+		if (!ACS) PROFILE_FOLD(SETUP_STAGE, MOVE_STAGE);
 		setMinPheromone();
-		for (int i = 0; i < nAnts; i++) {
-			ants.push_back(Ant(nNodes, euc));
+		bestTour = Tour(nNodes);
+		restartBestTour = Tour(nNodes);
+		buildInitialTour();
+		ants = AntPopulation(nAnts, nNodes, options.seed);
+		threadProbabilities.assign(nThreads, vector<double>(nNodes, 0.0));
+		threadDistances.assign(nThreads, distances.get());
+		bool alpha = options.candidates == ALPHA_CANDIDATES && (options.localSearch || options.sparse);
+		if (options.candidates == ALPHA_CANDIDATES && !alpha && options.verbose) {
+			cout << "Alpha candidates are only used by -ls and -sparse, ignored\n";
+		}
+		if (options.bound != NO_BOUND || alpha) lowerBound.reset(new HeldKarpBound(nodes, euc, *distances));
+		if (alpha) {
+			// Alpha-nearness is read from the final 1-tree: the ascent runs now, whatever the bound mode,
+			// on the time budget of the run, which solve() charges with it
+			auto ascentStart = chrono::steady_clock::now();
+			lowerBound->ascend([&]() {
+				return options.timeLimit > 0 &&
+					   chrono::duration<double>(chrono::steady_clock::now() - ascentStart).count() >= options.timeLimit;
+			});
+			boundStarted = true;
+			ascentSeconds = chrono::duration<double>(chrono::steady_clock::now() - ascentStart).count();
+			neighbors.reset(new NeighborLists(lowerBound->alphaNeighbors(NEIGHBORS)));
 		}
-		resetProbabilities();
+		else if (options.localSearch || options.sparse) neighbors.reset(new NeighborLists(nodes, euc));
+		if (options.sparse && euc) grid.reset(new SpatialGrid(nodes, nAnts));
+		if (options.localSearch) threadSearch.assign(nThreads, LocalSearch(*distances, *neighbors));
+		if (options.replicate) replicateReadOnlyData();
 	}
 	void solve() {
-        srand(time(NULL));
+        startTime = chrono::steady_clock::now() - chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(ascentSeconds));
+		ascentSeconds = 0.0;
 		clearTrails();
-		cout << "Algorithm used: ";
-		if (AC) cout << "AC\n";
-		else if(ACS) cout << "ACS\n";
-		else cout << "MMAS\n";
-		for (int iter = 0; iter < MAXITERATIONS; iter++) {
-			cout << "Iteration number " << iter << "\n";
+		if (bestTour.size() > 0) seedTrails();
+		iterationsDone = 0;
+		clearStagnation();
+		if (!options.resumePath.empty()) loadCheckpoint(options.resumePath);
+		iteration = iterationsDone;
+		startBound();
+		if (!observers.empty() && bestTour.size() > 0) notifyImprovement();
+		if (!options.tracePath.empty()) {
+#ifdef ANTCOLONY_PROFILE
+			PROFILE_TRACE(options.tracePath);
+#else
+			cout << "Tracing needs a build with ANTCOLONY_PROFILE\n";
+#endif
+		}
+		if (options.verbose) {
+			cout << "Algorithm used: ";
+			if (AC) cout << "AC\n";
+			else if(ACS) cout << "ACS\n";
+			else cout << "MMAS\n";
+		}
+		for (int iter = iterationsDone; iter < options.maxIterations; iter++) {
+			reportBound();
+			if (timeExpired() || isCancelled() || gapReached()) break;
+			iteration = iter;
+			if (options.verbose) cout << "Iteration number " << iter << "\n";
+			PROFILE_START_ITERATION();
 			//cout << "SETUP ANTS\n";
-			setupAnts();
+			auto iterationStart = chrono::steady_clock::now();
+			// Other algorithms set every ant up within its construction task
+			if (ACS) setupAnts();
 			//cout << "MOVE ANTS\n";
-			moveAnts();
+			if (!moveAnts()) break;
+			if (improveBestOnly) improveIterationBest();
+			auto constructed = chrono::steady_clock::now();
 			//cout << "UPDATE BEST TOUR\n";
 			updateBestTour();
 			//cout << "GLOBAL UPDATING PHEROMONE\n";
             globalUpdating();
+			if (MMAS && options.restart && isStagnating()) reinitializeTrails();
+			PROFILE_END_ITERATION(iter, bestTourLength);
+			iterationsDone = iter + 1;
+			if (iter == 0 && adaptsColony()) {
+				adaptColony(chrono::duration<double>(constructed - iterationStart).count(),
+							chrono::duration<double>(chrono::steady_clock::now() - constructed).count());
+			}
+			if (!observers.empty()) {
+				for (auto observer : observers) observer->onIteration(progress());
+			}
+			if (!options.checkpointPath.empty() && options.checkpointInterval > 0 && iterationsDone % options.checkpointInterval == 0) {
+				saveCheckpoint(options.checkpointPath);
+			}
+		}
+		stopBound();
+		if (!options.checkpointPath.empty()) saveCheckpoint(options.checkpointPath);
+		if (options.verbose) {
+			if (timeExpired()) cout << "Time budget expired\n";
+			if (gapReached()) cout << "Gap to the lower bound below " << options.gap << "\n";
+			if (isCancelled()) cout << "Cancelled after " << iterationsDone << " iterations\n";
+			cout << "Best cost: " << bestTourLength << "\n";
+			if (getLowerBound() > 0 && bestTourLength != DBL_MAX) {
+				cout << "Gap to the lower bound" << (lowerBound->isExact() ? "" : " (estimate)") << ": "
+					 << 100 * (bestTourLength - getLowerBound()) / getLowerBound() << "%\n";
+			}
+		}
+		PROFILE_REPORT(cout);
+		if (!observers.empty()) {
+			vector<int> tour = getBestTour();
+			for (auto observer : observers) observer->onFinish(progress(), tour);
 		}
-		cout << "Best cost: " << bestTourLength << "\n";
+	}
+
+	/*
+		* Register an observer of the next solve() calls. It must outlive them.
+		* Without observers the solver does no extra work.
+	*/
+	void addObserver(SolverObserver *observer) {
+		observers.push_back(observer);
+	}
+
+	/*
+		* Stop solve() before its next iteration once token is cancelled. The token must outlive solve().
+	*/
+	void setCancellationToken(const CancellationToken *token) {
+		cancellation = token;
+	}
+
+	string getName() {
+		return name;
+	}
+
+	/*
+		* Iterations completed by the last solve(), those before its checkpoint included
+	*/
+	int getIterations() {
+		return iterationsDone;
+	}
+
+	/*
+		* Return the best tour found, numbered as in the input file
+	*/
+	vector<int> getBestTour() {
+		vector<int> tour;
+		tour.reserve(bestTour.size());
+		for (int i = 0; i < bestTour.size(); i++) tour.push_back(originalIds[bestTour.node(i)]);
+		return tour;
+	}
+
+	double getBestTourLength() {
+		return bestTourLength;
+	}
+
+	/*
+		* Best lower bound on the tour length found so far, 0 if none
+	*/
+	double getLowerBound() {
+		return lowerBound ? lowerBound->value() : 0.0;
+	}
+
+	/*
+		* True if the best tour is within options.gap of an exact lower bound
+	*/
+	bool gapReached() {
+		if (options.gap <= 0 || !lowerBound || !lowerBound->isExact() || bestTourLength == DBL_MAX) return false;
+		double bound = lowerBound->value();
+		return bound > 0 && bestTourLength - bound <= options.gap * bound;
 	}
 private:
-	void setupAnts() {
-		for (auto ant = ants.begin(); ant != ants.end(); ant++) {
-			(*ant).clear();
-			(*ant).visitNode((rand() % nNodes));
+	/*
+		* Set up the process pool as options ask, then load the problem on it. A file that cannot be
+		* loaded ends the process with the code of the error.
+	*/
+	static shared_ptr<const Problem> load(string file, const SolverOptions &opts) {
+		ThreadPool::configure(opts.threads, opts.affinity || opts.replicate);
+		try {
+			return Problem::load(file, opts.reorder, opts.matrixFree);
+		}
+		catch (const LoadError &error) {
+			cout << error.what() << "\n";
+			exit(error.code);
 		}
-		currentIndex = 0;
 	}
-	void resetProbabilities() {
-        probabilities.clear();
-        for (int i = 0; i < nNodes; i++) {
-            probabilities.push_back(0.0);
-            //cout << "Prob: " << probabilities[i] << "\n";
-        }
+
+	SolverProgress progress() {
+		SolverProgress p;
+		p.iteration = iteration;
+		p.elapsed = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+		p.bestLength = bestTourLength;
+		p.iterationBestLength = iterationBestLength;
+		p.branching = branching;
+		p.distance = averageDistance;
+		p.lowerBound = getLowerBound();
+		return p;
 	}
-	void clearTrails() {
-		trails.clear();
-		for (int i = 0; i < nNodes; i++) {
-			trails.push_back(vector<double>(nNodes));
+
+	void notifyImprovement() {
+		vector<int> tour = getBestTour();
+		for (auto observer : observers) observer->onImprovement(progress(), tour);
+	}
+
+	/*
+		* Build the starting best tour with the constructor selected in options
+	*/
+	void buildInitialTour() {
+		if (options.initialTour == NO_INITIAL_TOUR) return;
+		InitialTour constructor(nodes, euc);
+		vector<int> tour = constructor.build(options.initialTour);
+		bestTour.assign(tour);
+		bestTourLength = constructor.length(tour);
+		if (MMAS) {
+			maxPheromone = nNodes / bestTourLength;
+		}
+		if (options.verbose) {
+			cout << "Initial tour (" << InitialTour::typeName(options.initialTour) << ") cost: " << bestTourLength << "\n";
 		}
+	}
+
+	/*
+		* Reinforce the starting tour edges up to the level the global update keeps on a best tour (1/L),
+		* so the first iterations are drawn towards it.
+	*/
+	void seedTrails() {
+		double seed = 1 / bestTourLength;
+		if (MMAS) seed = min(max(seed, minPheromone), maxPheromone);
 		for (int i = 0; i < nNodes; i++) {
-			for (int j = 0; j < nNodes; j++) {
-				trails[i][j] = minPheromone;
+			int node1 = bestTour.node(i);
+			int node2 = bestTour.succ(node1);
+			raiseTrail(node1, node2, seed);
+			raiseTrail(node2, node1, seed);
+		}
+	}
+
+	/*
+		* Bring the pheromone of arc (i, j) up to value, if the arc is stored
+	*/
+	void raiseTrail(int i, int j, double value) {
+		int index = trails.indexOf(i, j);
+		if (index < 0) return;
+		trails.row(i)[index] = max(trails.row(i)[index], value);
+		updateChoiceSum(i, index);
+	}
+
+	/*
+		* Recompute the choice info of the index-th arc of row i from its pheromone: tau * eta^BETA
+	*/
+	void updateChoice(int i, int index) {
+		trails.setChoice(i, index, trails.row(i)[index] * pow((1 / distances->get(i, trails.column(i, index))), BETA));
+	}
+
+	/*
+		* updateChoice for a single arc, outside of a whole row update: the row sum follows the change
+	*/
+	void updateChoiceSum(int i, int index) {
+		double before = rowSums ? choiceWeight(i, index) : 0.0;
+		updateChoice(i, index);
+		if (rowSums) rowSums->add(i, index, choiceWeight(i, index) - before);
+	}
+
+	/*
+		* Choice info of the index-th arc of row i as a sampling weight: 0 for the arc back to i, and for arcs
+		* between coincident cities whose choice info is infinite
+	*/
+	double choiceWeight(int i, int index) {
+		double weight = (trails.getPrecision() == SINGLE_PRECISION) ? trails.floatChoices(i)[index]
+																	: trails.doubleChoices(i)[index];
+		return (trails.column(i, index) == i || !isfinite(weight)) ? 0.0 : weight;
+	}
+
+	void sumRow(int i) {
+		rowSums->build(i, [&](int j) { return choiceWeight(i, j); });
+	}
+
+	void refreshChoices() {
+		pool->parallelFor(nNodes, ROWGRAIN, [&](int thread, int begin, int end) {
+			for (int i = begin; i < end; i++) {
+				for (int j = 0; j < trails.rowSize(); j++) updateChoice(i, j);
+				if (rowSums) sumRow(i);
 			}
+		});
+	}
+
+	/*
+		* True if exploration moves are drawn from sum trees: by request, or automatically on dense trails of
+		* TREESAMPLERNODES to TREESAMPLERMAXNODES cities. The trees are per row and shared by the ants, so
+		* visited cities stay in them: draws on visited cities are retried, and late in a tour the linear scan
+		* takes over. Sparse rows are short enough for the scan, and above the cap the n^2 doubles of the trees
+		* (128 MiB at the cap) would cost more memory than they save in time.
+	*/
+	bool usesTreeSampler() {
+		if (options.sparse || options.sampler == LINEAR_SAMPLER) return false;
+		return options.sampler == TREE_SAMPLER || (nNodes >= TREESAMPLERNODES && nNodes <= TREESAMPLERMAXNODES);
+	}
+
+	bool isCancelled() {
+		return cancellation && cancellation->isCancelled();
+	}
+
+	/*
+		* Run the lower bound ascent if one is asked for and has not run yet: now, or on its own thread
+		* alongside the iterations when the bound mode is parallel. Either way it ends with the time budget.
+	*/
+	void startBound() {
+		if (!lowerBound || boundStarted) return;
+		boundStarted = true;
+		auto expired = [this]() { return timeExpired() || isCancelled(); };
+		if (options.bound == PARALLEL_BOUND) boundThread = thread([this, expired]() { lowerBound->ascend(expired); });
+		else lowerBound->ascend(expired);
+	}
+
+	/*
+		* Stop a parallel ascent still running, keeping the best bound it reached
+	*/
+	void stopBound() {
+		if (boundThread.joinable()) {
+			lowerBound->cancel();
+			boundThread.join();
 		}
+		reportBound();
+	}
+
+	/*
+		* Print the bound and the gap of the best tour to it, when the bound has grown by a ten thousandth
+		* or become exact since last time
+	*/
+	void reportBound() {
+		if (!options.verbose || !lowerBound) return;
+		bool exact = lowerBound->isExact();
+		double bound = lowerBound->value();
+		if (bound <= 0 || (bound < reportedBound * 1.0001 && exact == reportedExact)) return;
+		reportedBound = bound;
+		reportedExact = exact;
+		cout << "Lower bound: " << bound << (exact ? "" : " (estimate)");
+		if (bestTourLength != DBL_MAX) cout << ", gap " << 100 * (bestTourLength - bound) / bound << "%";
+		cout << "\n";
+	}
+
+	/*
+		* Write the whole search state: pheromone, best and restart best tours, completed iterations and every ant's random stream.
+		* Resuming from it replays the remaining iterations exactly as an uninterrupted run, with any number of threads,
+		* unless the run stopped for the time budget in the middle of an iteration.
+	*/
+	void saveCheckpoint(const string &path) {
+		CheckpointWriter out(path);
+		out.putString(name);
+		out.put(nNodes);
+		out.put(nAnts);
+		out.put((int) improveBestOnly);
+		out.put(AC + 2 * ACS + 4 * MMAS);
+		out.put((int) options.reorder);
+		out.put((int) trails.isSparse());
+		out.put(trails.rowSize());
+		out.put((int) options.candidates);
+		out.put(options.seed);
+		out.put(iterationsDone);
+		out.put(minPheromone);
+		out.put(maxPheromone);
+		out.put(bestTourLength);
+		out.put(iterationBestLength);
+		out.put(bestTour.size());
+		for (int i = 0; i < bestTour.size(); i++) out.put(bestTour.node(i));
+		out.put(restarts);
+		out.put(restartIteration);
+		out.put(restartImproved);
+		out.put(averageDistance);
+		out.put(restartBestLength);
+		out.put(restartBestTour.size());
+		for (int i = 0; i < restartBestTour.size(); i++) out.put(restartBestTour.node(i));
+		for (int i = 0; i < nNodes; i++) out.putArray(trails.row(i), trails.rowSize());
+		out.put(trails.restValue());
+		for (int k = 0; k < nAnts; k++) out.putArray(ants.random(k).getState(), 4);
+		if (out.close() && options.verbose) cout << "Checkpoint written after " << iterationsDone << " iterations\n";
+	}
+
+	/*
+		* Restore the state written by saveCheckpoint. The problem, colony size, algorithm, reorder and sparse
+		* options must be the ones of the run that wrote it.
+	*/
+	void loadCheckpoint(const string &path) {
+		CheckpointReader in(path);
+		bool matches = in.getString().compare(name) == 0;
+		matches = in.get<int>() == nNodes && matches;
+		int savedAnts = in.get<int>();
+		// An adaptive colony resumes with the size it was given
+		if (savedAnts != nAnts && savedAnts > 0 && adaptsColony()) resizeColony(savedAnts);
+		matches = savedAnts == nAnts && matches;
+		improveBestOnly = in.get<int>() != 0;
+		matches = in.get<int>() == AC + 2 * ACS + 4 * MMAS && matches;
+		matches = in.get<int>() == (int) options.reorder && matches;
+		matches = in.get<int>() == (int) trails.isSparse() && matches;
+		matches = in.get<int>() == trails.rowSize() && matches;
+		// Alpha candidates give the sparse columns other arcs than the nearest ones
+		matches = in.get<int>() == (int) options.candidates && matches;
+		if (!matches) {
+			cout << "Checkpoint " << path << " was written for another problem or other options\n";
+			exit(8);
+		}
+		options.seed = in.get<uint64_t>();
+		iterationsDone = in.get<int>();
+		minPheromone = in.get<double>();
+		maxPheromone = in.get<double>();
+		bestTourLength = in.get<double>();
+		iterationBestLength = in.get<double>();
+		vector<int> tour(in.get<int>());
+		in.getArray(tour.data(), tour.size());
+		bestTour.assign(tour);
+		restarts = in.get<int>();
+		restartIteration = in.get<int>();
+		restartImproved = in.get<int>();
+		averageDistance = in.get<double>();
+		restartBestLength = in.get<double>();
+		tour.resize(in.get<int>());
+		in.getArray(tour.data(), tour.size());
+		restartBestTour.assign(tour);
+		for (int i = 0; i < nNodes; i++) in.getArray(trails.row(i), trails.rowSize());
+		trails.setRest(in.get<double>());
+		refreshChoices();
+		uint64_t state[4];
+		for (int k = 0; k < nAnts; k++) {
+			in.getArray(state, 4);
+			ants.random(k).setState(state);
+		}
+		if (options.verbose) cout << "Resumed from " << path << " after " << iterationsDone << " iterations\n";
+	}
+
+	/*
+		* Colony size before any iteration: options.ants if set, else the one of the colony policy.
+		* The adaptive policy starts from the mmas one.
+	*/
+	int initialColonySize() {
+		if (options.ants > 0) return options.ants;
+		if (options.colony == PROPORTIONAL_COLONY) return (int) (nNodes * ANTFACTOR);
+		if (options.colony == MMAS_COLONY) return MMASANTS;
+		return max(1, min(MMASANTS, (int) (nNodes * ANTFACTOR)));
+	}
+
+	bool adaptsColony() {
+		return options.ants == 0 && options.colony == ADAPTIVE_COLONY && options.timeLimit > 0;
+	}
+
+	/*
+		* Size the colony after the first iteration so that ADAPTIVEITERATIONS iterations fit in what is left of
+		* the time budget. Construction time is taken as proportional to the number of ants over the threads
+		* actually available, one when the colony runs inline on a pool worker as in batch mode,
+		* update time as fixed. If even ADAPTIVEMINANTS ants do not fit, local search is cut down to the
+		* iteration best ant. The colony never grows above nNodes * ANTFACTOR ants.
+	*/
+	void adaptColony(double constructionSeconds, double updateSeconds) {
+		int parallel = pool->parallelism();
+		int waves = (nAnts + parallel - 1) / parallel;
+		double antSeconds = constructionSeconds / (waves * parallel);
+		double left = options.timeLimit - chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+		int iterationsLeft = max(1, min(ADAPTIVEITERATIONS, options.maxIterations) - iterationsDone);
+		double antBudget = (left / iterationsLeft - updateSeconds) / max(antSeconds, 1e-9);
+		int most = max(ADAPTIVEMINANTS, (int) (nNodes * ANTFACTOR));
+		if (antBudget < ADAPTIVEMINANTS && options.localSearch) improveBestOnly = true;
+		int size = (int) min(max(antBudget, (double) ADAPTIVEMINANTS), (double) most);
+		if (options.verbose) {
+			cout << "Colony of " << size << " ants for " << iterationsLeft << " more iterations, " << antSeconds * 1e3
+				 << " ms per ant" << (improveBestOnly ? ", local search on the iteration best only" : "") << "\n";
+		}
+		if (size != nAnts) resizeColony(size);
+	}
+
+	void resizeColony(int size) {
+		nAnts = size;
+		ants.resize(nAnts, options.seed);
+		if (grid) grid.reset(new SpatialGrid(nodes, nAnts));
+	}
+
+	/*
+		* True once the time budget given in options is spent
+	*/
+	bool timeExpired() {
+		return options.timeLimit > 0 &&
+			   chrono::duration<double>(chrono::steady_clock::now() - startTime).count() >= options.timeLimit;
+	}
+
+	/*
+		* Every ant back to a single random city. Ants are independent, and resetting the grid is O(n) per ant,
+		* so they are set up on the pool.
+	*/
+	void setupAnts() {
+		PROFILE_SCOPE(SETUP_STAGE);
+		pool->parallelFor(nAnts, 1, [&](int thread, int begin, int end) {
+			for (int k = begin; k < end; k++) setupAnt(k, thread);
+		});
+	}
+
+	void setupAnt(int k, int thread) {
+		ants.clear(k);
+		if (grid) grid->reset(k);
+		visit(k, ants.random(k).below(nNodes), thread);
+	}
+
+	/*
+		* Ant k moves to node, -1 for none, on the distances of thread
+	*/
+	void visit(int k, int node, int thread) {
+		ants.visitNode(k, node, *threadDistances[thread]);
+		if (grid && node != -1) grid->remove(k, node);
+	}
+	/*
+		* Rows are allocated and filled on the pool, so that every row is first touched, and placed,
+		* by a worker of the same row split used by globalUpdating.
+	*/
+	void clearTrails() {
+		if (options.sparse) trails = PheromoneStore(*neighbors, minPheromone, options.precision, *pool);
+		else trails = PheromoneStore(nNodes, minPheromone, options.precision, *pool);
+		rowSums.reset(usesTreeSampler() ? new SumTree(nNodes, nNodes) : nullptr);
+		refreshChoices();
+	}
+
+	/*
+		* Give every NUMA node reached by the pinned workers its own copy of the distances and neighbor lists,
+		* made by the first worker of that node so its pages are local. The other workers of the node share it.
+	*/
+	void replicateReadOnlyData() {
+		vector<int> workerNode(nThreads, 0);
+		int nNumaNodes = 1;
+		for (int w = 0; w < nThreads; w++) {
+			if (pool->cpuOf(w) >= 0) workerNode[w] = numaNodeOfCpu(pool->cpuOf(w));
+			nNumaNodes = max(nNumaNodes, workerNode[w] + 1);
+		}
+		if (nNumaNodes == 1) return;
+		distanceReplicas.resize(nNumaNodes);
+		neighborReplicas.resize(nNumaNodes);
+		vector<int> firstWorker(nNumaNodes, -1);
+		for (int w = nThreads - 1; w >= 0; w--) firstWorker[workerNode[w]] = w;
+		pool->runOnEveryWorker([&](int worker) {
+			int node = workerNode[worker];
+			if (firstWorker[node] != worker) return;
+			distanceReplicas[node].reset(new DistanceMatrix(*distances));
+			if (neighbors) neighborReplicas[node].reset(new NeighborLists(*neighbors));
+		});
+		for (int w = 0; w < nThreads; w++) {
+			int node = workerNode[w];
+			threadDistances[w] = distanceReplicas[node].get();
+			if (!threadSearch.empty()) threadSearch[w] = LocalSearch(*threadDistances[w], *neighborReplicas[node]);
+		}
+		if (options.verbose) cout << "Read-only data replicated on " << nNumaNodes << " NUMA nodes\n";
 	}
 
 	/*
@@ -122,50 +768,145 @@ private:
 	        return;
 	    }
 		double average = 0.0;
-		for (int i = 0; i < nNodes; i++) {
-		    for(int j = 0; j < nNodes; j++) {
-		        if(i == j) continue;
-                average += distance(nodes[i], nodes[j]);
-		    }
+		if (distances->isDense()) {
+			for (int i = 0; i < nNodes; i++) {
+			    for(int j = 0; j < nNodes; j++) {
+			        if(i == j) continue;
+	                average += distances->get(i, j);
+			    }
+			}
+			average /= (double) nNodes * (nNodes - 1);
 		}
-		average /= nNodes * (nNodes - 1);
-		minPheromone = C / (nNodes * nNodes * average);
+		else {
+			// Matrix-free: the n^2 pairs would cost too much, average AVERAGESAMPLES pairs per node evenly spread
+			int samples = max(1, min(nNodes - 1, AVERAGESAMPLES));
+			for (int i = 0; i < nNodes; i++) {
+				for (int s = 0; s < samples; s++) {
+					average += distances->get(i, (int) ((i + 1 + (long long) s * (nNodes - 1) / samples) % nNodes));
+				}
+			}
+			average /= (double) nNodes * samples;
+		}
+		minPheromone = C / ((double) nNodes * nNodes * average);
 		if(minPheromone <= 0) minPheromone = 0.01;
 	}
 
 	/*
-		*
+		* Build every ant's tour, followed by its local search if enabled.
+		* Return false if the time budget expires before the tours are complete.
 	*/
-	void moveAnts() {
-		for (int i = 1; i < nNodes; i++) {
-			for (auto ant = ants.begin(); ant != ants.end(); ant++) {
-			    int node = selectNextNode(*ant);
-				(*ant).visitNode(node);
-				if(ACS) localUpdating(*ant);
+	bool moveAnts() {
+		PROFILE_SCOPE(MOVE_STAGE);
+		if (ACS) {
+			// Local updating changes trails while ants move: keep them in lockstep on one thread
+			for (int i = 1; i < nNodes; i++) {
+				if (timeExpired()) return false;
+				for (int k = 0; k < nAnts; k++) {
+				    int node = selectNextNode(k, 0);
+					visit(k, node, 0);
+					localUpdating(k);
+				}
 			}
-			currentIndex++;
+			if (options.localSearch) {
+				pool->parallelFor(nAnts, 1, [&](int thread, int begin, int end) {
+					for (int k = begin; k < end; k++) improveAnt(k, thread);
+				});
+			}
+			reduceBest();
+			return true;
 		}
+		// Trails are read-only during construction: ants are independent tasks, idle workers steal them.
+		// A task takes its ant from setup through local search to its thread's best, so a fast ant never
+		// waits on a stage barrier and the only one left in an iteration is before the pheromone update.
+		atomic<bool> expired(false);
+		threadBest.assign(nThreads, -1);
+		pool->parallelFor(nAnts, 1, [&](int thread, int begin, int end) {
+			for (int k = begin; k < end && !expired; k++) {
+				setupAnt(k, thread);
+				for (int i = 1; i < nNodes && !expired; i++) {
+					if (i % DEADLINESTEPS == 0 && timeExpired()) expired = true;
+					else visit(k, selectNextNode(k, thread), thread);
+				}
+				if (expired || timeExpired()) {
+					expired = true;
+					break;
+				}
+				improveAnt(k, thread);
+				if (isBetterAnt(k, threadBest[thread])) threadBest[thread] = k;
+			}
+		});
+		return !expired;
+	}
+
+	/*
+		* Best ant of every thread, by a min-reduction over the colony once every tour is complete
+	*/
+	void reduceBest() {
+		threadBest.assign(nThreads, -1);
+		pool->parallelFor(nAnts, REDUCTIONGRAIN, [&](int thread, int begin, int end) {
+			int best = threadBest[thread];
+			for (int k = begin; k < end; k++) {
+				if (isBetterAnt(k, best)) best = k;
+			}
+			threadBest[thread] = best;
+		});
+	}
+
+	/*
+		* Best ant of the last construction, merged from threadBest. Ties go to the lowest index,
+		* so the result does not depend on how ants were split among threads.
+	*/
+	int iterationBest() {
+		int best = -1;
+		for (int candidate : threadBest) {
+			if (isBetterAnt(candidate, best)) best = candidate;
+		}
+		return best;
+	}
+
+	/*
+		* Run the local search on ant k's complete tour
+	*/
+	void improveAnt(int k, int thread) {
+		if (options.localSearch && !improveBestOnly && ants.isComplete(k)) ants.improve(k, threadSearch[thread]);
+	}
+
+	/*
+		* Run the local search on the best tour of the iteration only
+	*/
+	void improveIterationBest() {
+		int best = iterationBest();
+		if (best != -1) ants.improve(best, threadSearch[0]);
 	}
 
 	/*
 		* Ant Colony System (ACS) method selecting next node to visit
 		* Pseudo Random Proportional Rule
 	*/
-	int selectNextNode(Ant ant) {
+	int selectNextNode(int k, int thread) {
+		const DistanceMatrix &distances = *threadDistances[thread];
 	    // If ACS or MMAS algorithm are selected we use probabilities to choose,
 	    // otherwise we use Exploration selection.
-	    double numrand = (ACS | MMAS) ? ((double) rand() / (RAND_MAX)) : 1.0;
+	    double numrand = (ACS | MMAS) ? ants.random(k).uniform() : 1.0;
+	    PROFILE_COUNT(thread, SELECTIONS, 1);
 		if (numrand < RANDOMFACTOR) {
+			PROFILE_COUNT(thread, EXPLOITATIONS, 1);
 			//cout << "EXPLOITATION SELECTION\n";
-			int i = ant.getTrailNode(currentIndex);
-			int node = -1;
+			int i = ants.lastNode(k);
+			int node = (trails.getPrecision() == SINGLE_PRECISION) ? bestChoice(k, i, trails.floatChoices(i))
+																   : bestChoice(k, i, trails.doubleChoices(i));
 			double argmax = 0.0;
-			for (int f = 0; f < nNodes; f++) {
-				if (!ant.isVisited(f)) {
-					double arg = trails[i][f] * pow((1 / distance(nodes[i],nodes[f])), BETA);
-					if (arg > argmax) {
-						argmax = arg;
-						node = f;
+			// Sparse trails with every candidate visited: all the other arcs share the rest value,
+			// so the best of them leads to the nearest unvisited node
+			if (node == -1 && trails.isSparse()) {
+				if (grid) return grid->nearest(k, i, [&](int f) { return distances.get(i, f); });
+				for (int f = 0; f < nNodes; f++) {
+					if (!ants.isVisited(k, f)) {
+						double arg = trails.restValue() * pow((1 / distances.get(i, f)), BETA);
+						if (arg > argmax) {
+							argmax = arg;
+							node = f;
+						}
 					}
 				}
 			}
@@ -173,49 +914,109 @@ private:
 		}
 		else {
 			//cout << "BAISED EXPLORATION SELECTION\n";
-			calculateProbabilities(ant);
-			double r = ((double) rand() / (RAND_MAX));
-			double total = 0.0;
-			int last = -1;
+			PROFILE_COUNT(thread, EXPLORATIONS, 1);
+			return rowSums ? sampleTree(k, thread) : sampleRow(k, thread);
+		}
+	}
+
+	/*
+		* Exploration move of ant k: roulette wheel over the probabilities of the last node's row, O(row)
+	*/
+	int sampleRow(int k, int thread) {
+		vector<double> &probabilities = threadProbabilities[thread];
+		int from = ants.lastNode(k);
+		bool onRow = calculateProbabilities(k, thread);
+		int count = onRow ? trails.rowSize() : nNodes;
+		double r = ants.random(k).uniform();
+		double total = 0.0;
+		int last = -1;
             //cout << "Rand: " << r << "\n";
-			for (int i = 0; i < nNodes; i++) {
-			    if(probabilities[i] != 0) last = i;
-				total += probabilities[i];
+		for (int i = 0; i < count; i++) {
+		    int node = onRow ? trails.column(from, i) : i;
+		    if(probabilities[i] != 0) last = node;
+			total += probabilities[i];
                 //cout << "Total: " << total << "\n";
-				if (total > r) {
-                    //cout << "NextNode: " << i << "\n\n";
-                    return i;
-				}
+			if (total > r) {
+                    //cout << "NextNode: " << node << "\n\n";
+                    return node;
 			}
-			if(last == -1) cout << "return -1\n";
-			return last;
 		}
+		if(last == -1) cout << "return -1\n";
+		return last;
 	}
 
 	/*
-		* Ant Colony (AC) method to calculate probabilities moving from one node to another -> Pk(r,s)
-		* Update probabilities vector
-	*/
-	void calculateProbabilities(Ant ant) {
-	    resetProbabilities();
-		int i = ant.getTrailNode(currentIndex);
-		double denominator = 0.0;
-		for (int f = 0; f < nNodes; f++) {
-			if (!ant.isVisited(f)) {
-				denominator += trails[i][f] * pow((1 / distance(nodes[i], nodes[f])), BETA);
+		* Exploration move of ant k drawn from the sum tree of the last node's row, O(log n). A draw landing on
+		* a visited node is repeated, which keeps the distribution of sampleRow. After TREESAMPLERTRIES misses,
+		* as happens late in a tour, sampleRow takes over.
+	*/
+	int sampleTree(int k, int thread) {
+		int from = ants.lastNode(k);
+		for (int t = 0; t < TREESAMPLERTRIES; t++) {
+			int node = rowSums->find(from, ants.random(k).uniform() * rowSums->total(from));
+			if (!ants.isVisited(k, node)) return node;
+		}
+		return sampleRow(k, thread);
+	}
+
+	/*
+		* Unvisited node of row i with the highest choice info, -1 if none
+	*/
+	template<typename Value>
+	int bestChoice(int k, int i, const Value *choice) {
+		int node = -1;
+		double argmax = 0.0;
+		for (int c = 0; c < trails.rowSize(); c++) {
+			int f = trails.column(i, c);
+			if (!ants.isVisited(k, f) && choice[c] > argmax) {
+				argmax = choice[c];
+				node = f;
 			}
 		}
-		//cout << "Denominator: " << denominator << "\n";
-		for (int f = 0; f < nNodes; f++) {
-			if (ant.isVisited(f)) {
-				probabilities[f] = 0.0;
+		return node;
+	}
+
+	/*
+		* Copy the choice info of the unvisited arcs of row i into probabilities, 0 for the others, and return their sum
+	*/
+	template<typename Value>
+	double weighRow(int k, int i, const Value *choice, vector<double> &probabilities) {
+		double total = 0.0;
+		for (int c = 0; c < trails.rowSize(); c++) {
+			probabilities[c] = ants.isVisited(k, trails.column(i, c)) ? 0.0 : (double) choice[c];
+			total += probabilities[c];
+		}
+		return total;
+	}
+
+	/*
+		* Ant Colony (AC) method to calculate probabilities moving from one node to another -> Pk(r,s)
+		* Overwrite the probabilities vector, indexed as the pheromone row of the last node.
+		* Return false if the sparse row has no unvisited candidate: probabilities are then indexed by node
+		* and spread over every unvisited node with the rest pheromone.
+	*/
+	bool calculateProbabilities(int k, int thread) {
+		const DistanceMatrix &distances = *threadDistances[thread];
+		vector<double> &probabilities = threadProbabilities[thread];
+		int i = ants.lastNode(k);
+		double denominator = (trails.getPrecision() == SINGLE_PRECISION) ? weighRow(k, i, trails.floatChoices(i), probabilities)
+																		 : weighRow(k, i, trails.doubleChoices(i), probabilities);
+		if (denominator == 0.0 && trails.isSparse()) {
+			for (int f = 0; f < nNodes; f++) {
+				probabilities[f] = ants.isVisited(k, f) ? 0.0 : pow((1 / distances.get(i, f)), BETA);
+				denominator += probabilities[f];
 			}
-			else {
-				double numerator = trails[i][f] * pow((1 / distance(nodes[i], nodes[f])), BETA);
-                probabilities[f] = (denominator == 0.0) ? 0.0 : numerator / denominator;
+			for (int f = 0; f < nNodes; f++) {
+				probabilities[f] = (denominator == 0.0) ? 0.0 : probabilities[f] / denominator;
 			}
-            //cout << "Prob: " << probabilities[f] << "\n";
+			return false;
 		}
+		//cout << "Denominator: " << denominator << "\n";
+		for (int c = 0; c < trails.rowSize(); c++) {
+            probabilities[c] = (denominator == 0.0) ? 0.0 : probabilities[c] / denominator;
+            //cout << "Prob: " << probabilities[c] << "\n";
+		}
+		return true;
 	}
 
 	/*
@@ -224,122 +1025,216 @@ private:
 		* We don't implement NNH, then we aproximate Lnn <- nNodes * nNodes * distance(i,j)
 		* Then we deposit more pheromone shortest is the distance(i,j).
 	*/
-	void localUpdating(Ant ant) {
-		int node1 = ant.getTrailNode(currentIndex);
-		int node2 = ant.getTrailNode(currentIndex + 1);
+	void localUpdating(int k) {
+		Tour trail = ants.getTour(k);
+		int node1 = trail.node(trail.size() - 2);
+		int node2 = trail.node(trail.size() - 1);
 		double delta = 1 / (nNodes * bestTourLength);
-		trails[node1][node2] = (1 - EVAPORATION) * trails[node1][node2] + EVAPORATION * delta;
+		int index = trails.indexOf(node1, node2);
+		if (index >= 0) {
+			double *row = trails.row(node1);
+			row[index] = (1 - EVAPORATION) * row[index] + EVAPORATION * delta;
+			updateChoiceSum(node1, index);
+		}
+		// ACS moves its ants in lockstep on the calling thread, worker 0
+		PROFILE_COUNT(0, PHEROMONE_CELLS, 1);
 	}
 
 	/*
 		* Global Pheromone Updating with ACS rule. Only best ant is allowed to deposit pheromone.
 		* In order to satisfy MMAS rule, pheromone is upper limited to maxPheromone
+		* With AC every ant deposits 1/L on its own edges.
+		* Rows are split among threads: every thread evaporates its rows and applies the deposits that fall
+		* on them, so no cell is shared and the result does not depend on the number of threads.
+		* Sparse trails drop the deposits on arcs outside the candidates, whose shared value only evaporates.
 	*/
 	void globalUpdating() {
-	    if(AC) {
-            for (int i = 0; i < nNodes; i++) {
-                for (int j = 0; j < nNodes; j++) {
-                    double delta = 0.0;
-                    for (auto ant = ants.begin(); ant != ants.end(); ant++) {
-                        if((*ant).isEdgeInTrail(i, j)){
-                            delta += 1 / (*ant).trailLength(nodes);
-                        }
-                    }
-                    trails[i][j] = (1 - EVAPORATION) * trails[i][j] + delta;
-                }
-            }
-	    }
-	    if(ACS || MMAS) {
-            for (int i = 0; i < nNodes; i++) {
-                for (int j = 0; j < nNodes; j++) {
-                    double delta = 0.0;
-                    if(isEdgeInBestTour(i, j)) {
-                        delta = 1 / bestTourLength;
-                    }
-                    trails[i][j] = (1 - EVAPORATION) * trails[i][j] + EVAPORATION * delta;
-                    if (MMAS) {
-                        if (trails[i][j] < minPheromone) trails[i][j] = minPheromone;
-                        if (trails[i][j] > maxPheromone) trails[i][j] = maxPheromone;
-                    }
-                }
-            }
-        }
+		PROFILE_SCOPE(UPDATE_STAGE);
+		PROFILE_COUNT(0, PHEROMONE_CELLS, (uint64_t) nNodes * trails.rowSize());
+		int width = trails.rowSize();
+		double rest = (1 - EVAPORATION) * trails.restValue();
+		if (MMAS) rest = min(max(rest, minPheromone), maxPheromone);
+		bool restartBest = depositsRestartBest();
+		const Tour &deposit = restartBest ? restartBestTour : bestTour;
+		double depositLength = restartBest ? restartBestLength : bestTourLength;
+		vector<long long> threadArcs(nThreads, 0);
+		pool->parallelFor(nNodes, ROWGRAIN, [&](int thread, int begin, int end) {
+			for (int i = begin; i < end; i++) {
+				double *row = trails.row(i);
+				for (int j = 0; j < width; j++) {
+					row[j] = (1 - EVAPORATION) * row[j];
+				}
+				if (AC) {
+					for (int k = 0; k < nAnts; k++) {
+						if (!ants.isComplete(k)) continue;
+						depositOnRow(i, ants.getTour(k), 1 / ants.trailLength(k));
+					}
+				}
+				if ((ACS || MMAS) && deposit.size() == nNodes) {
+					depositOnRow(i, deposit, EVAPORATION * (1 / depositLength));
+				}
+				if (MMAS) {
+					for (int j = 0; j < width; j++) {
+						if (row[j] < minPheromone) row[j] = minPheromone;
+						if (row[j] > maxPheromone) row[j] = maxPheromone;
+					}
+				}
+				for (int j = 0; j < width; j++) updateChoice(i, j);
+				if (rowSums) sumRow(i);
+				threadArcs[thread] += branchingArcs(i, rest);
+			}
+		});
+		trails.setRest(rest);
+		long long arcs = 0;
+		for (long long count : threadArcs) arcs += count;
+		branching = (double) arcs / nNodes;
 	}
 
 	/*
-		* Update Best Tour variable after an iteration of ant search.
+		* Arcs leaving node i whose pheromone is at least LAMBDA of the range of the row above its minimum,
+		* the arcs sharing the rest value included. Summed over the nodes it gives the lambda-branching factor.
 	*/
-	void updateBestTour() {
-		for (auto ant = ants.begin(); ant != ants.end(); ant++) {
-			if ((*ant).trailLength(nodes) < bestTourLength) {
-				bestTourLength = (*ant).trailLength(nodes);
-				bestTour = (*ant).getTrail();
-				if(MMAS) {
-				    maxPheromone = nNodes / bestTourLength;
-				}
-                printSolution();
-			}
+	long long branchingArcs(int i, double rest) {
+		const double *row = trails.row(i);
+		int width = trails.rowSize();
+		bool sparse = trails.isSparse();
+		double low = sparse ? rest : DBL_MAX;
+		double high = sparse ? rest : -DBL_MAX;
+		for (int j = 0; j < width; j++) {
+			if (!sparse && j == i) continue;
+			low = min(low, row[j]);
+			high = max(high, row[j]);
+		}
+		double limit = low + LAMBDA * (high - low);
+		long long arcs = 0;
+		for (int j = 0; j < width; j++) {
+			if ((sparse || j != i) && row[j] >= limit) arcs++;
 		}
+		if (sparse && rest >= limit) arcs += nNodes - 1 - width;
+		return arcs;
 	}
 
-	void printSolution(){
-        cout << "GLOBAL UPDATE SOLUTION!\nNew Best Solution Cost: " << bestTourLength << "\n";
-        /*cout << "Best Solution: \n";
-        for (int f = 0; f < nNodes; f++) {
-            cout << bestTour[f] << " - ";
-        }*/
-        chart.plotSolution(nodes, bestTour, nNodes);
+	/*
+		* True if MMAS lays pheromone on the restart best tour rather than the best one. Until the first
+		* reinitialization the two are the same tour. After one the best tour gets every GLOBALDEPOSITPERIOD-th deposit.
+	*/
+	bool depositsRestartBest() {
+		if (!MMAS || restarts == 0 || restartBestTour.size() != nNodes) return false;
+		return (iteration - restartIteration + 1) % GLOBALDEPOSITPERIOD != 0;
 	}
 
 	/*
-		* Euclidean distance from one node to another. Definition provided by TSP Data uni-heidelberg
+		* True once the restart best tour has not improved for STAGNATIONITERATIONS iterations and the trails
+		* hold little more than one tour, or the iteration best tours keep walking the best one
 	*/
-    double distance(pair<double, double> node1, pair<double, double> node2) {
-	    if(euc) {
-            double xd = node1.first - node2.first;
-            double yd = node1.second - node2.second;
-            return (int)(0.5 + sqrt(pow(xd, 2) + pow(yd, 2)));
-	    }
-	    else{
-            double deg = (int)(node1.first);
-            double min = node1.first - deg;
-            double lat_p1 = PI * (deg + 5.0*min / 3.0) / 180.0;
+	bool isStagnating() {
+		if (bestTour.size() != nNodes || iteration + 1 - restartImproved < STAGNATIONITERATIONS) return false;
+		return branching < STAGNATIONBRANCHING || averageDistance < STAGNATIONDISTANCE * nNodes;
+	}
 
-            deg = (int)(node1.second);
-            min = node1.second - deg;
-            double lon_p1 = PI * (deg + 5.0*min / 3.0) / 180.0;
+	/*
+		* Bring every trail up to maxPheromone and start a new restart best tour, as MMAS does on stagnation
+	*/
+	void reinitializeTrails() {
+		int width = trails.rowSize();
+		pool->parallelFor(nNodes, ROWGRAIN, [&](int thread, int begin, int end) {
+			for (int i = begin; i < end; i++) {
+				double *row = trails.row(i);
+				for (int j = 0; j < width; j++) row[j] = maxPheromone;
+				for (int j = 0; j < width; j++) updateChoice(i, j);
+				if (rowSums) sumRow(i);
+			}
+		});
+		trails.setRest(maxPheromone);
+		restarts++;
+		restartIteration = restartImproved = iteration + 1;
+		restartBestLength = DBL_MAX;
+		restartBestTour.clear();
+		averageDistance = nNodes;
+		if (options.verbose) cout << "Stagnation: trails reinitialized after " << iteration + 1 << " iterations\n";
+	}
 
-            deg = (int)(node2.first);
-            min = node2.first - deg;
-            double lat_p2 = PI * (deg + 5.0*min / 3.0) / 180.0;
+	/*
+		* Forget earlier restarts and stagnation metrics, the best tour so far is the restart best
+	*/
+	void clearStagnation() {
+		restarts = 0;
+		restartIteration = restartImproved = 0;
+		restartBestTour = bestTour;
+		restartBestLength = bestTourLength;
+		branching = 0.0;
+		averageDistance = nNodes;
+	}
 
-            deg = (int)(node2.second);
-            min = node2.second - deg;
-            double lon_p2 = PI * (deg + 5.0*min / 3.0) / 180.0;
+	/*
+		* Edges of the tour of ant k missing from the best tour
+	*/
+	int edgeDistance(int k) {
+		Tour tour = ants.getTour(k);
+		int missing = 0;
+		for (int i = 0; i < nNodes; i++) {
+			int node = tour.node(i);
+			if (!bestTour.hasEdge(node, tour.succ(node))) missing++;
+		}
+		return missing;
+	}
 
-            double q1 = cos(lon_p1 - lon_p2);
-            double q2 = cos(lat_p1 - lat_p2);
-            double q3 = cos(lat_p1 + lat_p2);
-            double d_p1_p2 = (int)(RRR*acos(0.5*((1.0 + q1)*q2 - (1.0 - q1)*q3)) + 1.0);
+	/*
+		* Add delta on the two edges of tour leaving node i
+	*/
+	void depositOnRow(int i, const Tour &tour, double delta) {
+		int next = tour.succ(i);
+		int prev = tour.pred(i);
+		double *cell = trails.find(i, next);
+		if (cell) *cell += delta;
+		cell = (prev != next) ? trails.find(i, prev) : nullptr;
+		if (cell) *cell += delta;
+	}
 
-            return d_p1_p2;
-	    }
+	/*
+		* Update Best Tour variable after an iteration of ant search.
+		* moveAnts already left the best ant of every thread in threadBest: only the merge is left.
+	*/
+	void updateBestTour() {
+		PROFILE_SCOPE(BEST_STAGE);
+		int best = iterationBest();
+		iterationBestLength = (best == -1) ? DBL_MAX : ants.trailLength(best);
+		if (best != -1 && bestTour.size() == nNodes) {
+			averageDistance += DISTANCESMOOTHING * (edgeDistance(best) - averageDistance);
+		}
+		if (best != -1 && ants.trailLength(best) < restartBestLength) {
+			restartBestLength = ants.trailLength(best);
+			restartBestTour = ants.getTour(best);
+			restartImproved = iteration;
+		}
+		if (best == -1 || ants.trailLength(best) >= bestTourLength) return;
+		bestTourLength = ants.trailLength(best);
+		bestTour = ants.getTour(best);
+		if(MMAS) {
+		    maxPheromone = nNodes / bestTourLength;
+		}
+		printSolution();
+		if (!observers.empty()) notifyImprovement();
+	}
+
+	/*
+		* True if ant k has a complete tour better than the one of ant other (-1 for none)
+	*/
+	bool isBetterAnt(int k, int other) {
+		if (k == -1 || !ants.isComplete(k)) return false;
+		if (other == -1) return true;
+		return ants.trailLength(k) < ants.trailLength(other) ||
+			   (ants.trailLength(k) == ants.trailLength(other) && k < other);
+	}
+
+	void printSolution(){
+        if (options.verbose) cout << "GLOBAL UPDATE SOLUTION!\nNew Best Solution Cost: " << bestTourLength << "\n";
+        /*cout << "Best Solution: \n";
+        for (int f = 0; f < nNodes; f++) {
+            cout << bestTour.node(f) << " - ";
+        }*/
+        if (chart) chart->plotSolution(nodes, bestTour);
 	}
+};
 
-	bool isEdgeInBestTour(int node1, int node2) {
-        int index = 0;
-        for (int i = 0; i < nNodes; i++) {
-            if(bestTour[i] == node1) index = i;
-        }
-        if(index == 0) {
-            if(bestTour[nNodes - 1] == node2) return true;
-        }
-        else if(index == (nNodes - 1)) {
-            if(bestTour[0] == node2) return true;
-        }
-        else {
-            if(bestTour[index - 1] == node2 || bestTour[index + 1] == node2) return true;
-        }
-        return false;
-    }
-};
\ No newline at end of file
+#endif // !ANT_COLONY_CLASS
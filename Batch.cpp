@@ -0,0 +1,210 @@
+#ifndef BATCH_CLASS
+#define BATCH_CLASS
+
+#include "TSP.h"
+#include "AntColony.cpp"
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+
+/*
+	* Problems of a batch, loaded once per file and kept only while some instance still needs them
+*/
+class ProblemCache {
+private:
+	struct Entry {
+		once_flag loaded;
+		shared_ptr<const Problem> problem;
+		int users = 0;					//	batch instances on this file not finished yet
+	};
+
+	CurveType curve;
+	bool matrixFree;
+	mutex lock;
+	map<string, shared_ptr<Entry>> entries;
+public:
+	ProblemCache(const vector<string> &files, CurveType reorder, bool noMatrix) : curve(reorder), matrixFree(noMatrix) {
+		for (auto &file : files) {
+			auto &entry = entries[file];
+			if (!entry) entry.reset(new Entry());
+			entry->users++;
+		}
+	}
+
+	/*
+		* Return the problem of file, loading it on the first request. Concurrent requests wait for that load.
+		* A load that throws is retried by the next request.
+	*/
+	shared_ptr<const Problem> acquire(const string &file) {
+		shared_ptr<Entry> entry;
+		{
+			lock_guard<mutex> guard(lock);
+			entry = entries[file];
+		}
+		call_once(entry->loaded, [&]() { entry->problem = Problem::load(file, curve, matrixFree); });
+		return entry->problem;
+	}
+
+	/*
+		* One instance on file is done: drop the problem after the last one
+	*/
+	void release(const string &file) {
+		lock_guard<mutex> guard(lock);
+		auto &entry = entries[file];
+		if (--entry->users == 0) entry->problem.reset();
+	}
+};
+
+/*
+	* Solve many instances in one process. Every instance runs on a single pool worker, so the pool
+	* solves as many instances at once as it has threads, and colonies of the same file share its problem.
+*/
+class BatchSolver {
+private:
+	SolverOptions options;
+	const CancellationToken *cancellation = nullptr;
+	mutex outputLock;
+	ofstream summary;
+
+public:
+	BatchSolver(SolverOptions opts) : options(opts) {
+		// Per-instance output would collide: the batch keeps quiet and writes the summary instead
+		options.plot = false;
+		options.verbose = false;
+		options.replicate = false;
+		options.checkpointPath.clear();
+		options.resumePath.clear();
+	}
+
+	void setCancellationToken(const CancellationToken *token) {
+		cancellation = token;
+	}
+
+	/*
+		* The .tsp files of a directory, by name, or the files listed in a manifest, one per line.
+		* Manifest paths are relative to the manifest, blank lines and lines starting with # are skipped.
+	*/
+	static vector<string> collect(string source) {
+		vector<string> files;
+		if (filesystem::is_directory(source)) {
+			for (auto &item : filesystem::directory_iterator(source)) {
+				if (item.is_regular_file() && item.path().extension() == ".tsp") files.push_back(item.path().string());
+			}
+			sort(files.begin(), files.end());
+			return files;
+		}
+		ifstream manifest(source);
+		if (!manifest.is_open()) {
+			cout << "Unable to open batch " << source << "\n";
+			exit(1);
+		}
+		filesystem::path base = filesystem::path(source).parent_path();
+		string line;
+		while (getline(manifest, line)) {
+			line.erase(line.find_last_not_of(" \t\r") + 1);
+			line.erase(0, line.find_first_not_of(" \t"));
+			if (line.empty() || line[0] == '#') continue;
+			filesystem::path file(line);
+			files.push_back((file.is_relative() ? base / file : file).string());
+		}
+		return files;
+	}
+
+	/*
+		* Solve every file and append one CSV row per instance to summaryPath as soon as it is done.
+		* Return the number of instances solved.
+	*/
+	int run(const vector<string> &files, string summaryPath) {
+		summary.open(summaryPath);
+		if (!summary.is_open()) {
+			cout << "Unable to open summary file " << summaryPath << "\n";
+			exit(1);
+		}
+		summary << "instance,name,cities,iterations,seconds,length,status\n";
+		ProblemCache cache(files, options.reorder, options.matrixFree);
+		atomic<int> solved(0);
+		ThreadPool &pool = ThreadPool::shared();
+		cout << "Batch of " << files.size() << " instances on " << pool.size() << " threads\n";
+		pool.parallelFor((int) files.size(), 1, [&](int thread, int begin, int end) {
+			for (int f = begin; f < end; f++) {
+				if (solveOne(files[f], cache)) solved++;
+			}
+		});
+		summary.close();
+		return solved;
+	}
+
+private:
+	bool solveOne(const string &file, ProblemCache &cache) {
+		auto start = chrono::steady_clock::now();
+		if (cancellation && cancellation->isCancelled()) {
+			cache.release(file);
+			write(file, "", 0, 0, 0.0, DBL_MAX, "cancelled");
+			return false;
+		}
+		if (!ifstream(file).is_open()) {
+			cache.release(file);
+			write(file, "", 0, 0, 0.0, DBL_MAX, "missing");
+			return false;
+		}
+		shared_ptr<const Problem> problem;
+		double length;
+		int iterations;
+		bool gap;
+		try {
+			problem = cache.acquire(file);
+			AntColony colony(problem, options);
+			colony.setCancellationToken(cancellation);
+			colony.solve();
+			length = colony.getBestTourLength();
+			iterations = colony.getIterations();
+			gap = colony.gapReached();
+		}
+		catch (const exception &error) {
+			// A bad file must not end the batch: report it and go on with the others
+			cache.release(file);
+			write(file, problem ? problem->name : "", problem ? problem->size() : 0, 0,
+				  chrono::duration<double>(chrono::steady_clock::now() - start).count(), DBL_MAX, "error");
+			lock_guard<mutex> guard(outputLock);
+			cout << "  " << error.what() << "\n";
+			return false;
+		}
+		cache.release(file);
+		double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		const char *status = "time limit";
+		if (iterations == options.maxIterations) status = "done";
+		else if (gap) status = "gap";
+		else if (cancellation && cancellation->isCancelled()) status = "cancelled";
+		write(file, problem->name, problem->size(), iterations, seconds, length, status);
+		return true;
+	}
+
+	/*
+		* text as a quoted CSV field, quotes inside doubled, so commas and quotes in paths or names keep the row intact
+	*/
+	static string csvField(const string &text) {
+		string field = "\"";
+		for (char c : text) {
+			if (c == '"') field += '"';
+			field += c;
+		}
+		return field + "\"";
+	}
+
+	void write(const string &file, const string &name, int cities, int iterations, double seconds, double length,
+			   const char *status) {
+		lock_guard<mutex> guard(outputLock);
+		summary << csvField(file) << "," << csvField(name) << "," << cities << "," << iterations << "," << fixed
+				<< setprecision(3) << seconds << "," << setprecision(0);
+		if (length < DBL_MAX) summary << length;
+		summary << "," << status << "\n" << defaultfloat;
+		summary.flush();
+		cout << left << setw(24) << (name.empty() ? file : name) << right << setw(10) << status;
+		if (length < DBL_MAX) cout << setw(14) << fixed << setprecision(0) << length << setw(10) << setprecision(2) << seconds << " s";
+		cout << "\n" << defaultfloat;
+	}
+};
+
+#endif // !BATCH_CLASS
@@ -0,0 +1,131 @@
+#ifndef CHECKPOINT_CLASS
+#define CHECKPOINT_CLASS
+
+#include "TSP.h"
+#include <atomic>
+#include <fstream>
+
+//First bytes of every checkpoint file, the last one is the format version
+constexpr auto CHECKPOINTMAGIC = "ANTCKPT4";
+
+/*
+	* Flag raised by another thread, or a signal handler, to stop a running solve() before its next iteration
+*/
+class CancellationToken {
+private:
+	atomic<bool> cancelled{false};
+public:
+	void cancel() {
+		cancelled = true;
+	}
+
+	bool isCancelled() const {
+		return cancelled;
+	}
+
+	void reset() {
+		cancelled = false;
+	}
+};
+
+/*
+	* Binary checkpoint output. Values are written as they are in memory, so a checkpoint moves between
+	* machines of the same byte order. Data goes to path.tmp, renamed over path by close(): a crash
+	* while writing leaves the previous checkpoint intact.
+*/
+class CheckpointWriter {
+private:
+	string path;
+	ofstream file;
+public:
+	CheckpointWriter(string p) : path(p), file(p + ".tmp", ios::binary) {
+		if (!file.is_open()) {
+			cout << "Unable to open checkpoint file " << path << "\n";
+			return;
+		}
+		file.write(CHECKPOINTMAGIC, 8);
+	}
+
+	template<typename T>
+	void put(const T &value) {
+		file.write((const char *) &value, sizeof(T));
+	}
+
+	template<typename T>
+	void putArray(const T *values, size_t count) {
+		file.write((const char *) values, sizeof(T) * count);
+	}
+
+	void putString(const string &value) {
+		put((uint64_t) value.size());
+		file.write(value.data(), value.size());
+	}
+
+	/*
+		* Return false if anything failed, the previous checkpoint is then kept
+	*/
+	bool close() {
+		if (!file.is_open()) return false;
+		file.close();
+		if (file.fail()) {
+			cout << "Unable to write checkpoint file " << path << "\n";
+			return false;
+		}
+#ifdef _WIN32
+		remove(path.c_str());
+#endif
+		return rename((path + ".tmp").c_str(), path.c_str()) == 0;
+	}
+};
+
+/*
+	* Binary checkpoint input, exits on a missing, foreign or truncated file
+*/
+class CheckpointReader {
+private:
+	string path;
+	ifstream file;
+
+	void check() {
+		if (!file) {
+			cout << "Corrupt checkpoint file " << path << "\n";
+			exit(8);
+		}
+	}
+public:
+	CheckpointReader(string p) : path(p), file(p, ios::binary) {
+		if (!file.is_open()) {
+			cout << "Unable to open checkpoint file " << path << "\n";
+			exit(8);
+		}
+		char magic[8];
+		file.read(magic, 8);
+		if (!file || string(magic, 8).compare(CHECKPOINTMAGIC) != 0) {
+			cout << path << " is not a checkpoint of this version\n";
+			exit(8);
+		}
+	}
+
+	template<typename T>
+	T get() {
+		T value;
+		file.read((char *) &value, sizeof(T));
+		check();
+		return value;
+	}
+
+	template<typename T>
+	void getArray(T *values, size_t count) {
+		file.read((char *) values, sizeof(T) * count);
+		check();
+	}
+
+	string getString() {
+		string value(get<uint64_t>(), '\0');
+		file.read(&value[0], value.size());
+		check();
+		return value;
+	}
+};
+
+#endif // !CHECKPOINT_CLASS
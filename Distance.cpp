@@ -0,0 +1,181 @@
+#ifndef DISTANCE_FUNCTIONS
+#define DISTANCE_FUNCTIONS
+
+#include "TSP.h"
+#include "ThreadPool.cpp"
+#include <cstring>
+
+constexpr auto PI = (double) 3.1415926535897;
+
+constexpr auto RRR = (double) 6378.388;
+
+/*
+	* Euclidean distance from one node to another. Definition provided by TSP Data uni-heidelberg
+*/
+inline double eucDistance(const pair<double, double> &node1, const pair<double, double> &node2) {
+    double xd = node1.first - node2.first;
+    double yd = node1.second - node2.second;
+    return (int)(0.5 + sqrt(pow(xd, 2) + pow(yd, 2)));
+}
+
+/*
+	* Geographical distance from one node to another. Definition provided by TSP Data uni-heidelberg
+*/
+inline double geoDistance(const pair<double, double> &node1, const pair<double, double> &node2) {
+    double deg = (int)(node1.first);
+    double min = node1.first - deg;
+    double lat_p1 = PI * (deg + 5.0*min / 3.0) / 180.0;
+
+    deg = (int)(node1.second);
+    min = node1.second - deg;
+    double lon_p1 = PI * (deg + 5.0*min / 3.0) / 180.0;
+
+    deg = (int)(node2.first);
+    min = node2.first - deg;
+    double lat_p2 = PI * (deg + 5.0*min / 3.0) / 180.0;
+
+    deg = (int)(node2.second);
+    min = node2.second - deg;
+    double lon_p2 = PI * (deg + 5.0*min / 3.0) / 180.0;
+
+    double q1 = cos(lon_p1 - lon_p2);
+    double q2 = cos(lat_p1 - lat_p2);
+    double q3 = cos(lat_p1 + lat_p2);
+    double d_p1_p2 = (int)(RRR*acos(0.5*((1.0 + q1)*q2 - (1.0 - q1)*q3)) + 1.0);
+
+    return d_p1_p2;
+}
+
+inline double tspDistance(const pair<double, double> &node1, const pair<double, double> &node2, bool euc) {
+    return euc ? eucDistance(node1, node2) : geoDistance(node1, node2);
+}
+
+//Largest instance given a dense matrix unless asked otherwise: 32768^2 int32 distances take 4 GiB
+constexpr auto MAXMATRIXNODES = (int) 32768;
+
+/*
+	* TSPLIB GEO coordinate (degrees.minutes) to radians
+*/
+inline double geoRadians(double coordinate) {
+    double deg = (int)(coordinate);
+    double min = coordinate - deg;
+    return PI * (deg + 5.0*min / 3.0) / 180.0;
+}
+
+/*
+	* Distances between all the nodes, behind one get(i, j) whatever the storage.
+	* Dense: computed once at load time into an n x n matrix. TSPLIB distances are rounded to integers,
+	* so they are stored exactly as int32: half the memory of double. The storage is left uninitialized
+	* on allocation so that its pages are first touched, and therefore placed on the NUMA node of, the thread filling them.
+	* Matrix-free: computed on every call from per-node geometry prepared at load time, the coordinates
+	* for EUC_2D and the sines and cosines of latitude and longitude for GEO, so that a GEO distance
+	* is a few products and one acos. Memory is linear in the number of nodes.
+*/
+class DistanceMatrix {
+private:
+	struct Geometry {
+		double x, y;					//	EUC_2D coordinates
+		double cosLat, sinLat, cosLon, sinLon;	//	GEO
+	};
+
+	int nNodes = 0;
+	bool euc = true;
+	unique_ptr<int32_t[]> matrix;	//	nNodes x nNodes, row major, null when matrix-free
+	vector<Geometry> geometry;		//	one per node, matrix-free only
+
+	/*
+		* Same rounding as eucDistance and geoDistance. For GEO, cos(a - b) and cos(a + b) are expanded
+		* on the cached sines and cosines.
+	*/
+	double compute(int node1, int node2) const {
+		const Geometry &a = geometry[node1];
+		const Geometry &b = geometry[node2];
+		if (euc) {
+			double xd = a.x - b.x;
+			double yd = a.y - b.y;
+			return (int)(0.5 + sqrt(xd * xd + yd * yd));
+		}
+		double q1 = a.cosLon * b.cosLon + a.sinLon * b.sinLon;
+		double cc = a.cosLat * b.cosLat;
+		double ss = a.sinLat * b.sinLat;
+		double q2 = cc + ss;
+		double q3 = cc - ss;
+		return (int)(RRR*acos(min(1.0, 0.5*((1.0 + q1)*q2 - (1.0 - q1)*q3))) + 1.0);
+	}
+public:
+	DistanceMatrix() {}
+
+	/*
+		* Dense rows are filled in parallel on pool, each by the worker that first touches them
+	*/
+	DistanceMatrix(const vector<pair<double, double>> &nodes, bool e, bool dense = true, ThreadPool &pool = ThreadPool::shared())
+		: nNodes((int) nodes.size()), euc(e) {
+		// eucDistance already rounds to int: check the longest possible distance, the bounding box diagonal
+		if (euc && nNodes > 0) {
+			double minX = DBL_MAX, minY = DBL_MAX, maxX = -DBL_MAX, maxY = -DBL_MAX;
+			for (auto &node : nodes) {
+				minX = min(minX, node.first);
+				maxX = max(maxX, node.first);
+				minY = min(minY, node.second);
+				maxY = max(maxY, node.second);
+			}
+			if (0.5 + sqrt(pow(maxX - minX, 2) + pow(maxY - minY, 2)) > INT32_MAX) {
+				throw LoadError("Distances beyond 2^31 are not supported", 9);
+			}
+		}
+		if (!dense) {
+			geometry.resize(nNodes);
+			for (int i = 0; i < nNodes; i++) {
+				Geometry &g = geometry[i];
+				g.x = nodes[i].first;
+				g.y = nodes[i].second;
+				double lat = geoRadians(nodes[i].first);
+				double lon = geoRadians(nodes[i].second);
+				g.cosLat = cos(lat);
+				g.sinLat = sin(lat);
+				g.cosLon = cos(lon);
+				g.sinLon = sin(lon);
+			}
+			return;
+		}
+		matrix.reset(new int32_t[(size_t) nNodes * nNodes]);
+		pool.parallelFor(nNodes, 16, [&](int thread, int begin, int end) {
+			for (int i = begin; i < end; i++) {
+				int32_t *row = &matrix[(size_t) i * nNodes];
+				for (int j = 0; j < nNodes; j++) {
+					row[j] = (int32_t) tspDistance(nodes[i], nodes[j], euc);
+				}
+			}
+		});
+	}
+
+	/*
+		* Copy made by the calling thread: a replica local to its NUMA node
+	*/
+	DistanceMatrix(const DistanceMatrix &other) : nNodes(other.nNodes), euc(other.euc), geometry(other.geometry) {
+		if (!other.matrix) return;
+		matrix.reset(new int32_t[(size_t) nNodes * nNodes]);
+		memcpy(matrix.get(), other.matrix.get(), sizeof(int32_t) * nNodes * nNodes);
+	}
+
+	DistanceMatrix(DistanceMatrix &&other) = default;
+	DistanceMatrix &operator=(DistanceMatrix &&other) = default;
+
+	double get(int node1, int node2) const {
+		if (matrix) return matrix[(size_t) node1 * nNodes + node2];
+		return compute(node1, node2);
+	}
+
+	/*
+		* True if distances are stored, false if computed on every call
+	*/
+	bool isDense() const {
+		return matrix != nullptr;
+	}
+
+	int size() const {
+		return nNodes;
+	}
+};
+
+#endif // !DISTANCE_FUNCTIONS
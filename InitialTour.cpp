@@ -0,0 +1,208 @@
+#ifndef INITIAL_TOUR_CLASS
+#define INITIAL_TOUR_CLASS
+
+#include "TSP.h"
+#include "Distance.cpp"
+#include "SpaceFillingCurve.cpp"
+#include "NeighborLists.cpp"
+
+enum InitialTourType { NO_INITIAL_TOUR, HILBERT_TOUR, GREEDY_TOUR, SPANNING_TREE_TOUR };
+
+/*
+	* Fast tour constructors for large instances. Every constructor is O(n log n): they never look at
+	* more than the NEIGHBORS nearest neighbors of a node, and disconnected pieces are chained along
+	* the Hilbert curve.
+*/
+class InitialTour {
+private:
+	const vector<pair<double, double>> &nodes;
+	int nNodes;
+	bool euc;
+	vector<int> curve;		//	nodes sorted along the Hilbert curve
+public:
+	InitialTour(const vector<pair<double, double>> &graph, bool e) : nodes(graph), euc(e) {
+		nNodes = (int) nodes.size();
+		curve = curveOrder(nodes);
+	}
+
+	/*
+		* Map a command line name to its constructor
+	*/
+	static InitialTourType parseType(string name) {
+		if (name.compare("none") == 0) return NO_INITIAL_TOUR;
+		if (name.compare("hilbert") == 0) return HILBERT_TOUR;
+		if (name.compare("greedy") == 0) return GREEDY_TOUR;
+		if (name.compare("mst") == 0) return SPANNING_TREE_TOUR;
+		cout << "Unknown initial tour: " << name << "\n";
+		exit(7);
+	}
+
+	static string typeName(InitialTourType type) {
+		switch (type) {
+			case HILBERT_TOUR: return "hilbert";
+			case GREEDY_TOUR: return "greedy";
+			case SPANNING_TREE_TOUR: return "mst";
+			default: return "none";
+		}
+	}
+
+	/*
+		* Return the tour produced by the selected constructor, empty for NO_INITIAL_TOUR
+	*/
+	vector<int> build(InitialTourType type) {
+		switch (type) {
+			case HILBERT_TOUR: return curve;
+			case GREEDY_TOUR: return greedyTour();
+			case SPANNING_TREE_TOUR: return spanningTreeTour();
+			default: return vector<int>();
+		}
+	}
+
+	/*
+		* Return tour's total length
+	*/
+	double length(const vector<int> &tour) {
+		double total = tspDistance(nodes[tour[0]], nodes[tour[nNodes - 1]], euc);
+		for (int i = 0; i < nNodes - 1; i++) {
+			total += tspDistance(nodes[tour[i]], nodes[tour[i + 1]], euc);
+		}
+		return total;
+	}
+
+private:
+	/*
+		* Greedy edge matching: take candidate edges shortest first while no node gets degree 3
+		* and no subtour is closed. Rounds are repeated on the path ends until no edge can be added,
+		* then the remaining paths are joined along the Hilbert curve.
+	*/
+	vector<int> greedyTour() {
+		vector<int> parent(nNodes);
+		iota(parent.begin(), parent.end(), 0);
+		vector<int> adj(2 * nNodes, -1);
+		vector<int> degree(nNodes, 0);
+		vector<int> ends(curve);
+		while (ends.size() > 2) {
+			bool added = false;
+			for (auto &edge : candidateEdges(ends)) {
+				int a = edge.first, b = edge.second;
+				if (degree[a] == 2 || degree[b] == 2) continue;
+				int ra = findRoot(parent, a), rb = findRoot(parent, b);
+				if (ra == rb) continue;
+				parent[ra] = rb;
+				adj[2 * a + degree[a]++] = b;
+				adj[2 * b + degree[b]++] = a;
+				added = true;
+			}
+			if (!added) break;
+			ends.erase(remove_if(ends.begin(), ends.end(), [&degree](int node) { return degree[node] == 2; }), ends.end());
+		}
+
+		vector<int> tour;
+		vector<bool> done(nNodes, false);
+		for (int c : curve) {
+			if (done[c]) continue;
+			// Find both ends of the path through c, then enter it from the end closest to the tour
+			int first = pathEnd(adj, c, -1);
+			int second = pathEnd(adj, first, -1);
+			int start = first;
+			if (!tour.empty() && tspDistance(nodes[tour.back()], nodes[second], euc) <
+								 tspDistance(nodes[tour.back()], nodes[first], euc)) {
+				start = second;
+			}
+			int prev = -1, cur = start;
+			while (cur != -1) {
+				tour.push_back(cur);
+				done[cur] = true;
+				int next = (adj[2 * cur] != prev) ? adj[2 * cur] : adj[2 * cur + 1];
+				prev = cur;
+				cur = next;
+			}
+		}
+		return tour;
+	}
+
+	/*
+		* Double-tree tour: minimum spanning forest of the candidate graph (Kruskal), trees taken in
+		* Hilbert order of their roots and shortcut by a preorder walk, nearest child first.
+	*/
+	vector<int> spanningTreeTour() {
+		vector<int> parent(nNodes);
+		iota(parent.begin(), parent.end(), 0);
+		vector<vector<int>> tree(nNodes);
+		for (auto &edge : candidateEdges(curve)) {
+			int ra = findRoot(parent, edge.first), rb = findRoot(parent, edge.second);
+			if (ra == rb) continue;
+			parent[ra] = rb;
+			tree[edge.first].push_back(edge.second);
+			tree[edge.second].push_back(edge.first);
+		}
+
+		vector<int> tour;
+		vector<bool> done(nNodes, false);
+		vector<int> stack;
+		for (int root : curve) {
+			if (done[root]) continue;
+			stack.push_back(root);
+			done[root] = true;
+			while (!stack.empty()) {
+				int node = stack.back();
+				stack.pop_back();
+				tour.push_back(node);
+				// Kruskal inserted children shortest edge first: push them reversed to visit nearest first
+				for (auto child = tree[node].rbegin(); child != tree[node].rend(); child++) {
+					if (!done[*child]) {
+						done[*child] = true;
+						stack.push_back(*child);
+					}
+				}
+			}
+		}
+		return tour;
+	}
+
+	/*
+		* Undirected nearest-neighbor edges among subset, sorted by length
+	*/
+	vector<pair<int, int>> candidateEdges(const vector<int> &subset) {
+		vector<pair<double, double>> points;
+		points.reserve(subset.size());
+		for (int node : subset) points.push_back(nodes[node]);
+		NeighborLists neighbors(points, euc);
+		vector<pair<double, pair<int, int>>> edges;
+		edges.reserve(subset.size() * neighbors.size());
+		for (int i = 0; i < (int) subset.size(); i++) {
+			for (int f = 0; f < neighbors.size(); f++) {
+				int a = subset[i], b = subset[neighbors.get(i, f)];
+				edges.push_back(make_pair(tspDistance(nodes[a], nodes[b], euc), make_pair(min(a, b), max(a, b))));
+			}
+		}
+		sort(edges.begin(), edges.end());
+		edges.erase(unique(edges.begin(), edges.end()), edges.end());
+		vector<pair<int, int>> sorted;
+		sorted.reserve(edges.size());
+		for (auto &edge : edges) sorted.push_back(edge.second);
+		return sorted;
+	}
+
+	/*
+		* Walk a path of the greedy matching from node, away from prev, and return its last node
+	*/
+	int pathEnd(const vector<int> &adj, int node, int prev) {
+		while (true) {
+			int next = (adj[2 * node] != prev) ? adj[2 * node] : adj[2 * node + 1];
+			if (next == -1) return node;
+			prev = node;
+			node = next;
+		}
+	}
+
+	int findRoot(vector<int> &parent, int node) {
+		while (parent[node] != node) {
+			parent[node] = parent[parent[node]];
+			node = parent[node];
+		}
+		return node;
+	}
+};
+
+#endif // !INITIAL_TOUR_CLASS
@@ -0,0 +1,79 @@
+#ifndef LOCAL_SEARCH_CLASS
+#define LOCAL_SEARCH_CLASS
+
+#include "TSP.h"
+#include "Distance.cpp"
+#include "NeighborLists.cpp"
+#include "Tour.cpp"
+
+/*
+	* 2-opt local search restricted to neighbor lists, with don't-look bits kept as a queue of active cities.
+	* Every thread owns one LocalSearch: the queue buffers are reused between tours.
+*/
+class LocalSearch {
+private:
+	const DistanceMatrix *distances;
+	const NeighborLists *neighbors;
+	vector<int> queue;
+	vector<char> queued;
+
+	void activate(int city, size_t &tail) {
+		if (queued[city]) return;
+		queued[city] = 1;
+		queue[tail++ % queue.size()] = city;
+	}
+public:
+	LocalSearch(const DistanceMatrix &d, const NeighborLists &n) : distances(&d), neighbors(&n) {
+		queue.resize(d.size());
+		queued.resize(d.size());
+	}
+
+	/*
+		* Apply improving 2-opt moves until none is left. Return the length saved.
+	*/
+	double twoOpt(Tour &tour) {
+		int n = tour.size();
+		if (n < 5) return 0.0;
+		double gain = 0.0;
+		size_t head = 0, tail = 0;
+		for (int i = 0; i < n; i++) {
+			queued[tour.node(i)] = 0;
+		}
+		for (int i = 0; i < n; i++) activate(tour.node(i), tail);
+		while (head != tail) {
+			int a = queue[head++ % queue.size()];
+			queued[a] = 0;
+			bool improved = false;
+			for (int forward = 1; forward >= 0 && !improved; forward--) {
+				int aNext = forward ? tour.succ(a) : tour.pred(a);
+				double removed = distances->get(a, aNext);
+				for (int f = 0; f < neighbors->size(); f++) {
+					int c = neighbors->get(a, f);
+					double added = distances->get(a, c);
+					if (added >= removed) {
+						if (neighbors->isNearestFirst()) break;
+						continue;
+					}
+					int cNext = forward ? tour.succ(c) : tour.pred(c);
+					if (c == aNext || cNext == a) continue;
+					double delta = removed + distances->get(c, cNext) - added - distances->get(aNext, cNext);
+					if (delta > 0) {
+						// Edges (a, aNext) and (c, cNext) become (a, c) and (aNext, cNext)
+						if (forward) tour.reverse(tour.position(aNext), tour.position(c));
+						else tour.reverse(tour.position(c), tour.position(aNext));
+						gain += delta;
+						activate(a, tail);
+						activate(aNext, tail);
+						activate(c, tail);
+						activate(cNext, tail);
+						improved = true;
+						break;
+					}
+				}
+			}
+		}
+		return gain;
+	}
+};
+
+#endif // !LOCAL_SEARCH_CLASS
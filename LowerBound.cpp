@@ -0,0 +1,368 @@
+#ifndef LOWER_BOUND_CLASS
+#define LOWER_BOUND_CLASS
+
+#include "TSP.h"
+#include "Distance.cpp"
+#include "NeighborLists.cpp"
+#include "SpaceFillingCurve.cpp"
+#include <atomic>
+#include <functional>
+#include <queue>
+
+//Nearest neighbors of every node in the graph the subgradient ascent builds its 1-trees on
+constexpr auto HELDKARPNEIGHBORS = (int) 16;
+
+//Steps of the first period of the ascent, the longest one
+constexpr auto HELDKARPPERIOD = (int) 100;
+
+//Most nodes for which the final 1-tree is computed on the complete graph, in O(n^2), making the bound exact
+constexpr auto HELDKARPEXACTNODES = (int) 10000;
+
+enum BoundMode {
+	NO_BOUND,
+	STARTUP_BOUND,
+	PARALLEL_BOUND
+};
+
+/*
+	* Lower bound mode named on the command line: none, startup or parallel
+*/
+inline BoundMode parseBound(string name) {
+	if (name.compare("none") == 0) return NO_BOUND;
+	if (name.compare("startup") == 0) return STARTUP_BOUND;
+	if (name.compare("parallel") == 0) return PARALLEL_BOUND;
+	cout << "Unknown bound " << name << ", use none, startup or parallel\n";
+	exit(7);
+}
+
+enum CandidateType {
+	NEAREST_CANDIDATES,
+	ALPHA_CANDIDATES
+};
+
+/*
+	* Candidate lists named on the command line: nearest or alpha
+*/
+inline CandidateType parseCandidates(string name) {
+	if (name.compare("nearest") == 0) return NEAREST_CANDIDATES;
+	if (name.compare("alpha") == 0) return ALPHA_CANDIDATES;
+	cout << "Unknown candidates " << name << ", use nearest or alpha\n";
+	exit(7);
+}
+
+/*
+	* Held-Karp lower bound: the longest minimum 1-tree over node penalties pi, found by subgradient ascent
+	* with the step and period schedule of LKH. The 1-trees of the ascent are spanning trees of a sparse graph,
+	* the HELDKARPNEIGHBORS nearest neighbors of every node plus a Hilbert curve path that keeps it connected,
+	* so a step costs O(n k log n). Up to HELDKARPEXACTNODES nodes the best penalties are then evaluated on the
+	* complete graph and the bound is exact, above that it is an estimate that may exceed the true one.
+	* ascend() may run on its own thread: value() and isExact() can be read from any thread meanwhile.
+*/
+class HeldKarpBound {
+private:
+	int nNodes = 0;
+	const DistanceMatrix *distances = nullptr;
+	vector<int> edgeStart;			//	first edge of every node in edgeEnds
+	vector<int> edgeEnds;			//	other end of every edge of the sparse graph, both directions
+	vector<double> edgeLengths;		//	distance of every edge in edgeEnds
+	vector<double> pi;				//	penalties of the best 1-tree
+	vector<int> parent;				//	parent of every node in the best 1-tree, rooted at node 1; node 0 hangs on special
+	int special[2] = {-1, -1};		//	the two ends of node 0, nearest first
+	atomic<double> bound;
+	atomic<bool> exact;
+	atomic<bool> stopping;
+
+	double cost(int i, int j, double length) const {
+		return length + pi[i] + pi[j];
+	}
+
+	/*
+		* Minimum 1-tree of the sparse graph under penalties pi: a spanning tree of nodes 1..n-1 by Prim, plus the
+		* two cheapest edges of node 0. Leave the degrees in degree, the tree in parent and special if asked.
+		* Return its cost minus twice the penalties.
+	*/
+	double oneTree(vector<int> &degree, bool keepTree) {
+		vector<double> key(nNodes, DBL_MAX);
+		vector<int> from(nNodes, -1);
+		vector<char> inTree(nNodes, 0);
+		priority_queue<pair<double, int>, vector<pair<double, int>>, greater<pair<double, int>>> heap;
+		fill(degree.begin(), degree.end(), 0);
+		double total = 0.0;
+		key[1] = 0.0;
+		heap.push(make_pair(0.0, 1));
+		while (!heap.empty()) {
+			int i = heap.top().second;
+			double d = heap.top().first;
+			heap.pop();
+			if (inTree[i] || d > key[i]) continue;
+			inTree[i] = 1;
+			total += d;
+			if (from[i] != -1) {
+				degree[i]++;
+				degree[from[i]]++;
+			}
+			for (int e = edgeStart[i]; e < edgeStart[i + 1]; e++) {
+				int j = edgeEnds[e];
+				if (j == 0 || inTree[j]) continue;
+				double c = cost(i, j, edgeLengths[e]);
+				if (c < key[j]) {
+					key[j] = c;
+					from[j] = i;
+					heap.push(make_pair(c, j));
+				}
+			}
+		}
+		int ends[2] = {-1, -1};
+		double costs[2] = {DBL_MAX, DBL_MAX};
+		for (int e = edgeStart[0]; e < edgeStart[1]; e++) {
+			double c = cost(0, edgeEnds[e], edgeLengths[e]);
+			if (c < costs[0]) {
+				ends[1] = ends[0];
+				costs[1] = costs[0];
+				ends[0] = edgeEnds[e];
+				costs[0] = c;
+			}
+			else if (c < costs[1]) {
+				ends[1] = edgeEnds[e];
+				costs[1] = c;
+			}
+		}
+		total += costs[0] + costs[1];
+		degree[0] = 2;
+		degree[ends[0]]++;
+		degree[ends[1]]++;
+		if (keepTree) {
+			parent = from;
+			special[0] = ends[0];
+			special[1] = ends[1];
+		}
+		for (int i = 0; i < nNodes; i++) total -= 2 * pi[i];
+		return total;
+	}
+
+	/*
+		* Minimum 1-tree of the complete graph under pi, by the O(n^2) Prim, minus twice the penalties
+	*/
+	double exactOneTree() {
+		vector<double> key(nNodes, DBL_MAX);
+		vector<char> inTree(nNodes, 0);
+		double total = 0.0;
+		int i = 1;
+		key[1] = 0.0;
+		for (int added = 1; added < nNodes; added++) {
+			inTree[i] = 1;
+			total += key[i];
+			int next = -1;
+			for (int j = 1; j < nNodes; j++) {
+				if (inTree[j]) continue;
+				double c = distances->get(i, j) + pi[i] + pi[j];
+				if (c < key[j]) key[j] = c;
+				if (next == -1 || key[j] < key[next]) next = j;
+			}
+			i = next;
+		}
+		double first = DBL_MAX, second = DBL_MAX;
+		for (int j = 1; j < nNodes; j++) {
+			double c = distances->get(0, j) + pi[0] + pi[j];
+			if (c < first) {
+				second = first;
+				first = c;
+			}
+			else if (c < second) second = c;
+		}
+		total += first + second;
+		for (int j = 0; j < nNodes; j++) total -= 2 * pi[j];
+		return total;
+	}
+
+public:
+	/*
+		* Bound of the problem on nodes with distances d, 0 until ascend() runs
+	*/
+	HeldKarpBound(const vector<pair<double, double>> &nodes, bool euc, const DistanceMatrix &d)
+		: nNodes((int) nodes.size()), distances(&d), bound(0.0), exact(false), stopping(false) {
+		pi.assign(nNodes, 0.0);
+		if (nNodes < 3) return;
+		NeighborLists nearest(nodes, euc, HELDKARPNEIGHBORS);
+		vector<pair<int, int>> edges;
+		edges.reserve((size_t) 2 * nNodes * (nearest.size() + 1));
+		for (int i = 0; i < nNodes; i++) {
+			for (int f = 0; f < nearest.size(); f++) {
+				edges.push_back(make_pair(i, nearest.get(i, f)));
+				edges.push_back(make_pair(nearest.get(i, f), i));
+			}
+		}
+		// Node 0 stays off the path: the tree of the other nodes must be connected without it
+		vector<int> path = curveOrder(nodes);
+		path.erase(find(path.begin(), path.end(), 0));
+		for (int t = 0; t + 1 < (int) path.size(); t++) {
+			edges.push_back(make_pair(path[t], path[t + 1]));
+			edges.push_back(make_pair(path[t + 1], path[t]));
+		}
+		sort(edges.begin(), edges.end());
+		edges.erase(unique(edges.begin(), edges.end()), edges.end());
+		edgeStart.assign(nNodes + 1, 0);
+		edgeEnds.resize(edges.size());
+		edgeLengths.resize(edges.size());
+		for (size_t e = 0; e < edges.size(); e++) {
+			edgeStart[edges[e].first + 1]++;
+			edgeEnds[e] = edges[e].second;
+			edgeLengths[e] = d.get(edges[e].first, edges[e].second);
+		}
+		for (int i = 0; i < nNodes; i++) edgeStart[i + 1] += edgeStart[i];
+	}
+
+	/*
+		* Run the subgradient ascent, publishing every better bound, until it converges, cancel() is called
+		* or expired, if given, returns true. Stopped early, the bound is the best so far and stays an estimate,
+		* and alphaNeighbors() works on the 1-tree of the best penalties so far.
+	*/
+	void ascend(const function<bool()> &expired = nullptr) {
+		if (nNodes < 3) return;
+		vector<int> degree(nNodes, 0);
+		vector<double> lastV(nNodes, 0.0);
+		vector<double> bestPi(pi);
+		double bestW = oneTree(degree, false);
+		bound.store(bestW);
+		double step = 1.0;
+		bool initialPhase = true;
+		long long norm = 1;
+		bool stopped = false;
+		for (int period = HELDKARPPERIOD; period > 0 && norm != 0 && !stopped; period /= 2, step /= 2) {
+			for (int p = 1; p <= period && norm != 0; p++) {
+				if (stopping.load() || (expired && expired())) {
+					stopped = true;
+					break;
+				}
+				norm = 0;
+				for (int i = 0; i < nNodes; i++) norm += (long long) (degree[i] - 2) * (degree[i] - 2);
+				// A 1-tree with every degree 2 is a tour: no penalty can raise it
+				if (norm == 0) break;
+				for (int i = 0; i < nNodes; i++) {
+					int v = degree[i] - 2;
+					pi[i] += step * (0.7 * v + 0.3 * lastV[i]);
+					lastV[i] = v;
+				}
+				double w = oneTree(degree, false);
+				if (w > bestW) {
+					bestW = w;
+					bestPi = pi;
+					bound.store(bestW);
+					if (initialPhase) step *= 2;
+					if (p == period) period = min(2 * period, HELDKARPPERIOD);
+				}
+				else if (initialPhase && p > period / 2) {
+					initialPhase = false;
+					p = 0;
+					step = 3 * step / 4;
+				}
+			}
+		}
+		pi = bestPi;
+		oneTree(degree, true);
+		if (!stopped && nNodes <= HELDKARPEXACTNODES) {
+			bound.store(exactOneTree());
+			exact.store(true);
+		}
+	}
+
+	/*
+		* Make a running ascend() return with the best bound so far
+	*/
+	void cancel() {
+		stopping.store(true);
+	}
+
+	/*
+		* Best bound so far, 0 before ascend()
+	*/
+	double value() const {
+		return bound.load();
+	}
+
+	/*
+		* True once the bound is final and holds for the complete graph
+	*/
+	bool isExact() const {
+		return exact.load();
+	}
+
+	/*
+		* For every node its k sparse graph neighbors of least alpha-nearness, the growth of the best 1-tree when
+		* the edge is forced in, nearest first on ties. Needs a completed ascend().
+	*/
+	NeighborLists alphaNeighbors(int k) {
+		k = max(0, min(k, nNodes - 1));
+		vector<int> lists((size_t) nNodes * k);
+		if (nNodes < 3 || parent.empty()) return NeighborLists(nNodes, k, lists, false);
+		// Binary lifting on the tree of nodes 1..n-1: ancestor 2^l levels up and the costliest edge on the way
+		int levels = 1;
+		while ((1 << levels) < nNodes) levels++;
+		vector<int> depth(nNodes, 0), order;
+		vector<vector<int>> children(nNodes);
+		for (int i = 1; i < nNodes; i++) if (parent[i] != -1) children[parent[i]].push_back(i);
+		order.push_back(1);
+		for (size_t t = 0; t < order.size(); t++) {
+			for (int c : children[order[t]]) {
+				depth[c] = depth[order[t]] + 1;
+				order.push_back(c);
+			}
+		}
+		vector<int> up((size_t) levels * nNodes, 1);
+		vector<double> heaviest((size_t) levels * nNodes, 0.0);
+		for (int i = 1; i < nNodes; i++) {
+			if (parent[i] == -1) continue;
+			up[i] = parent[i];
+			heaviest[i] = cost(i, parent[i], distances->get(i, parent[i]));
+		}
+		for (int l = 1; l < levels; l++) {
+			for (int i = 1; i < nNodes; i++) {
+				int half = up[(size_t) (l - 1) * nNodes + i];
+				up[(size_t) l * nNodes + i] = up[(size_t) (l - 1) * nNodes + half];
+				heaviest[(size_t) l * nNodes + i] = max(heaviest[(size_t) (l - 1) * nNodes + i], heaviest[(size_t) (l - 1) * nNodes + half]);
+			}
+		}
+		auto beta = [&](int a, int b) {
+			double most = 0.0;
+			if (depth[a] < depth[b]) swap(a, b);
+			for (int l = levels - 1; l >= 0; l--) {
+				if (depth[a] - (1 << l) >= depth[b]) {
+					most = max(most, heaviest[(size_t) l * nNodes + a]);
+					a = up[(size_t) l * nNodes + a];
+				}
+			}
+			if (a == b) return most;
+			for (int l = levels - 1; l >= 0; l--) {
+				if (up[(size_t) l * nNodes + a] != up[(size_t) l * nNodes + b]) {
+					most = max(most, max(heaviest[(size_t) l * nNodes + a], heaviest[(size_t) l * nNodes + b]));
+					a = up[(size_t) l * nNodes + a];
+					b = up[(size_t) l * nNodes + b];
+				}
+			}
+			return max(most, max(heaviest[a], heaviest[b]));
+		};
+		double secondSpecial = cost(0, special[1], distances->get(0, special[1]));
+		vector<pair<pair<double, double>, int>> ranked;
+		for (int i = 0; i < nNodes; i++) {
+			ranked.clear();
+			for (int e = edgeStart[i]; e < edgeStart[i + 1]; e++) {
+				int j = edgeEnds[e];
+				double c = cost(i, j, edgeLengths[e]);
+				double alpha;
+				if (i == 0 || j == 0) {
+					int other = (i == 0) ? j : i;
+					alpha = (other == special[0] || other == special[1]) ? 0.0 : c - secondSpecial;
+				}
+				else if (parent[i] == j || parent[j] == i) alpha = 0.0;
+				else alpha = c - beta(i, j);
+				ranked.push_back(make_pair(make_pair(alpha, edgeLengths[e]), j));
+			}
+			int kept = min(k, (int) ranked.size());
+			partial_sort(ranked.begin(), ranked.begin() + kept, ranked.end());
+			for (int f = 0; f < kept; f++) lists[(size_t) i * k + f] = ranked[f].second;
+		}
+		return NeighborLists(nNodes, k, lists, false);
+	}
+};
+
+#endif // !LOWER_BOUND_CLASS
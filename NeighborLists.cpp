@@ -0,0 +1,131 @@
+#ifndef NEIGHBOR_LISTS_CLASS
+#define NEIGHBOR_LISTS_CLASS
+
+#include "TSP.h"
+#include "Distance.cpp"
+#include <queue>
+
+//Number of nearest neighbors kept for every node
+constexpr auto NEIGHBORS = (int) 10;
+
+/*
+	* k nearest neighbors of every node, found through a uniform grid in O(n k log k) instead of O(n^2).
+	* The search runs on planar coordinates (exact ranking for EUC_2D, a good approximation for GEO),
+	* then every list is sorted by the real TSP distance.
+*/
+class NeighborLists {
+private:
+	int nNodes;
+	int k;
+	vector<int> neighbors;		//	nNodes x k matrix, nearest first unless built from other lists
+	bool nearestFirst = true;
+public:
+	/*
+		* Lists given as an nodes x nearest matrix, in the order candidates should be tried
+	*/
+	NeighborLists(int nodes, int nearest, vector<int> lists, bool sortedByDistance)
+		: nNodes(nodes), k(nearest), neighbors(move(lists)), nearestFirst(sortedByDistance) {}
+
+	NeighborLists(const vector<pair<double, double>> &nodes, bool euc, int nearest = NEIGHBORS) {
+		nNodes = (int) nodes.size();
+		k = max(0, min(nearest, nNodes - 1));
+		neighbors.resize((size_t) nNodes * k);
+		if (k == 0) return;
+
+		double minX = DBL_MAX, minY = DBL_MAX, maxX = -DBL_MAX, maxY = -DBL_MAX;
+		for (auto &node : nodes) {
+			minX = min(minX, node.first);
+			maxX = max(maxX, node.first);
+			minY = min(minY, node.second);
+			maxY = max(maxY, node.second);
+		}
+		// About two nodes per cell
+		int side = max(1, (int) sqrt(nNodes / 2.0));
+		double cellSize = max(maxX - minX, maxY - minY) / side;
+		if (cellSize <= 0) cellSize = 1.0;
+		auto cellOf = [&](double v, double lo) { return min(side - 1, (int) ((v - lo) / cellSize)); };
+
+		vector<int> cellStart(side * side + 1, 0);
+		vector<int> cellItems(nNodes);
+		vector<int> cells(nNodes);
+		for (int i = 0; i < nNodes; i++) {
+			cells[i] = cellOf(nodes[i].second, minY) * side + cellOf(nodes[i].first, minX);
+			cellStart[cells[i] + 1]++;
+		}
+		for (int c = 0; c < side * side; c++) cellStart[c + 1] += cellStart[c];
+		vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+		for (int i = 0; i < nNodes; i++) cellItems[fill[cells[i]]++] = i;
+
+		priority_queue<pair<double, int>> heap;
+		for (int i = 0; i < nNodes; i++) {
+			int cx = cells[i] % side, cy = cells[i] / side;
+			for (int r = 0; r <= side; r++) {
+				if ((int) heap.size() == k && heap.top().first <= pow(max(0, r - 1) * cellSize, 2)) break;
+				for (int y = cy - r; y <= cy + r; y++) {
+					if (y < 0 || y >= side) continue;
+					bool border = (y == cy - r || y == cy + r);
+					for (int x = cx - r; x <= cx + r; x += (border || r == 0) ? 1 : 2 * r) {
+						if (x < 0 || x >= side) continue;
+						for (int c = cellStart[y * side + x]; c < cellStart[y * side + x + 1]; c++) {
+							int j = cellItems[c];
+							if (j == i) continue;
+							double dx = nodes[i].first - nodes[j].first;
+							double dy = nodes[i].second - nodes[j].second;
+							double d = dx * dx + dy * dy;
+							if ((int) heap.size() < k) heap.push(make_pair(d, j));
+							else if (d < heap.top().first) {
+								heap.pop();
+								heap.push(make_pair(d, j));
+							}
+						}
+					}
+				}
+			}
+			int *list = &neighbors[(size_t) i * k];
+			for (int f = k - 1; f >= 0; f--) {
+				list[f] = heap.top().second;
+				heap.pop();
+			}
+			stable_sort(list, list + k, [&](int a, int b) {
+				return tspDistance(nodes[i], nodes[a], euc) < tspDistance(nodes[i], nodes[b], euc);
+			});
+		}
+	}
+
+	/*
+		* Number of nodes with a list
+	*/
+	int nodes() const {
+		return nNodes;
+	}
+
+	/*
+		* Number of neighbors stored for every node
+	*/
+	int size() const {
+		return k;
+	}
+
+	/*
+		* True if every list is sorted by distance, so a scan can stop at the first neighbor too far away
+	*/
+	bool isNearestFirst() const {
+		return nearestFirst;
+	}
+
+	/*
+		* Return the index-th nearest neighbor of node
+	*/
+	int get(int node, int index) const {
+		return neighbors[(size_t) node * k + index];
+	}
+
+	/*
+		* Return a pointer to the k neighbors of node, nearest first
+	*/
+	const int *of(int node) const {
+		return &neighbors[(size_t) node * k];
+	}
+};
+
+#endif // !NEIGHBOR_LISTS_CLASS
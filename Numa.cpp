@@ -0,0 +1,36 @@
+#ifndef NUMA_FUNCTIONS
+#define NUMA_FUNCTIONS
+
+#include "TSP.h"
+#include <fstream>
+#include <sstream>
+
+//Highest NUMA node number looked up in sysfs
+constexpr auto MAXNUMANODES = (int) 64;
+
+/*
+	* NUMA node cpu belongs to, read from the cpulist file of every /sys/devices/system/node/nodeN.
+	* 0 where the topology is unknown.
+*/
+inline int numaNodeOfCpu(int cpu) {
+#ifdef __linux__
+    for (int node = 0; node < MAXNUMANODES; node++) {
+        ifstream file("/sys/devices/system/node/node" + to_string(node) + "/cpulist");
+        if (!file.is_open()) continue;
+        string list, range;
+        getline(file, list);
+        stringstream ranges(list);
+        // cpulist looks like "0-7,16-23"
+        while (getline(ranges, range, ',')) {
+            if (range.empty()) continue;
+            size_t dash = range.find('-');
+            int first = stoi(range.substr(0, dash));
+            int last = (dash == string::npos) ? first : stoi(range.substr(dash + 1));
+            if (cpu >= first && cpu <= last) return node;
+        }
+    }
+#endif
+    return 0;
+}
+
+#endif // !NUMA_FUNCTIONS
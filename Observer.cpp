@@ -0,0 +1,179 @@
+#ifndef OBSERVER_CLASS
+#define OBSERVER_CLASS
+
+#include "TSP.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+/*
+	* State of the search handed to the observers
+*/
+struct SolverProgress {
+	int iteration = 0;						//	current iteration, 0 based
+	double elapsed = 0.0;					//	seconds since solve() started
+	double bestLength = DBL_MAX;			//	best tour so far, DBL_MAX if none yet
+	double iterationBestLength = DBL_MAX;	//	best complete tour of this iteration, DBL_MAX if none
+	double branching = 0.0;					//	average lambda-branching factor of the trails, 2 when they hold one tour
+	double distance = 0.0;					//	running average of the iteration best edges missing from the best tour
+	double lowerBound = 0.0;				//	Held-Karp bound on the tour length so far, 0 if none
+};
+
+/*
+	* Callbacks of a running solve(). They are called on the solver thread between iterations,
+	* so they should return quickly. Tours are numbered as in the input file, from 0.
+*/
+class SolverObserver {
+public:
+	virtual ~SolverObserver() {}
+
+	virtual void onIteration(const SolverProgress &progress) {}
+
+	virtual void onImprovement(const SolverProgress &progress, const vector<int> &tour) {}
+
+	virtual void onFinish(const SolverProgress &progress, const vector<int> &tour) {}
+};
+
+/*
+	* Observer writing one JSON line per event to a progress file and the best tour as a TSPLIB .tour file.
+	* The solver thread only queues the events: a writer thread of its own does the I/O, and when it falls
+	* behind only the newest pending tour is written. The tour file is replaced atomically through a rename.
+*/
+class ProgressWriter : public SolverObserver {
+private:
+	string name;
+	ofstream progress;					//	touched by the writer thread only once open
+	bool logging = false;				//	progress file open
+	string tourPath;
+
+	mutex lock;
+	condition_variable wake;
+	deque<string> lines;				//	JSON lines not written yet
+	vector<int> pendingTour;			//	newest tour not written yet
+	double pendingLength = 0.0;
+	bool tourPending = false;
+	bool finished = false;
+	thread writer;
+
+public:
+	/*
+		* Empty paths disable the matching output. name goes in the NAME field of the tour file.
+	*/
+	ProgressWriter(string progressPath, string tour, string problemName) : name(problemName), tourPath(tour) {
+		if (!progressPath.empty()) {
+			progress.open(progressPath);
+			logging = progress.is_open();
+			if (!logging) cout << "Unable to open progress file " << progressPath << "\n";
+		}
+		writer = thread([this]() { run(); });
+	}
+
+	/*
+		* Flush every queued event before returning
+	*/
+	~ProgressWriter() {
+		{
+			lock_guard<mutex> guard(lock);
+			finished = true;
+		}
+		wake.notify_one();
+		writer.join();
+	}
+
+	void onIteration(const SolverProgress &p) override {
+		if (logging) push(line("iteration", p), nullptr, 0.0);
+	}
+
+	void onImprovement(const SolverProgress &p, const vector<int> &tour) override {
+		push(logging ? line("improvement", p) : string(), &tour, p.bestLength);
+	}
+
+	void onFinish(const SolverProgress &p, const vector<int> &tour) override {
+		push(logging ? line("finish", p) : string(), &tour, p.bestLength);
+	}
+
+private:
+	static string line(const char *event, const SolverProgress &p) {
+		ostringstream out;
+		out << setprecision(15) << "{\"event\":\"" << event << "\",\"iteration\":" << p.iteration
+			<< ",\"elapsed\":" << p.elapsed << ",\"best\":";
+		if (p.bestLength == DBL_MAX) out << "null";
+		else out << p.bestLength;
+		out << ",\"iterationBest\":";
+		if (p.iterationBestLength == DBL_MAX) out << "null";
+		else out << p.iterationBestLength;
+		out << ",\"branching\":" << p.branching << ",\"distance\":" << p.distance << ",\"bound\":";
+		if (p.lowerBound <= 0) out << "null";
+		else out << p.lowerBound;
+		out << "}\n";
+		return out.str();
+	}
+
+	void push(string text, const vector<int> *tour, double length) {
+		{
+			lock_guard<mutex> guard(lock);
+			if (!text.empty()) lines.push_back(move(text));
+			if (tour && !tourPath.empty() && !tour->empty()) {
+				pendingTour = *tour;
+				pendingLength = length;
+				tourPending = true;
+			}
+		}
+		wake.notify_one();
+	}
+
+	void run() {
+		deque<string> batch;
+		vector<int> tour;
+		double length = 0.0;
+		while (true) {
+			bool writeTour = false;
+			bool done;
+			{
+				unique_lock<mutex> guard(lock);
+				wake.wait(guard, [this]() { return finished || tourPending || !lines.empty(); });
+				batch.swap(lines);
+				if (tourPending) {
+					tour.swap(pendingTour);
+					length = pendingLength;
+					tourPending = false;
+					writeTour = true;
+				}
+				done = finished;
+			}
+			for (auto &text : batch) progress << text;
+			if (!batch.empty()) progress.flush();
+			batch.clear();
+			if (writeTour) writeTourFile(tour, length);
+			if (done) return;
+		}
+	}
+
+	/*
+		* TSPLIB tour: nodes are numbered from 1 in the order of the input file
+	*/
+	void writeTourFile(const vector<int> &tour, double length) {
+		string temporary = tourPath + ".tmp";
+		{
+			ofstream file(temporary);
+			if (!file.is_open()) {
+				cout << "Unable to open tour file " << tourPath << "\n";
+				return;
+			}
+			file << setprecision(15) << "NAME : " << name << ".tour\nCOMMENT : Length = " << length
+				 << "\nTYPE : TOUR\nDIMENSION : " << tour.size() << "\nTOUR_SECTION\n";
+			for (int node : tour) file << node + 1 << "\n";
+			file << "-1\nEOF\n";
+		}
+#ifdef _WIN32
+		remove(tourPath.c_str());
+#endif
+		rename(temporary.c_str(), tourPath.c_str());
+	}
+};
+
+#endif // !OBSERVER_CLASS
@@ -1,4 +1,8 @@
+#ifndef PARSER_CLASS
+#define PARSER_CLASS
+
 #include "TSP.h"
+#include "SpaceFillingCurve.cpp"
 #include <fstream>
 #include <boost/tokenizer.hpp>
 
@@ -10,6 +14,7 @@ private:
 	bool euc = false;
 	bool geo = false;
     vector<pair<double, double>> nodes;
+    vector<int> originalIds;	// file position of every node, identity unless reordered
 public:
 	Parser(string path) : filePath(path) {}
 	void parse() {
@@ -43,7 +48,7 @@ public:
                     else if(word.compare("TYPE:") == 0) {
                         beg++;
                         string type(*beg);
-                        if(type.compare("TSP") != 0) exit(5);
+                        if(type.compare("TSP") != 0) throw LoadError("Unsupported problem type " + type, 5);
                     }
                     else if(word.compare("DIMENSION:") == 0) {
                         beg++;
@@ -54,7 +59,7 @@ public:
                         string weight(*beg);
                         if(weight.compare("EUC_2D")==0) euc = true;
                         else if(weight.compare("GEO")==0) geo = true;
-                        else exit(6);
+                        else throw LoadError("Unsupported edge weight type " + weight, 6);
                     }
                     else if (line.compare("NODE_COORD_SECTION") == 0) takeData = true;
                     tok.end();
@@ -62,11 +67,21 @@ public:
 			}
 		}
 		else {
-			cout << "Unable to open file";
-			exit(1);
+			throw LoadError("Unable to open file " + filePath, 1);
 		}
 	}
 
+	/*
+	 * Renumber nodes along a space-filling curve so that cities close in space get close indices.
+	 */
+	void reorder(CurveType curve) {
+        originalIds = curveOrder(nodes, curve);
+        vector<pair<double, double>> sorted;
+        sorted.reserve(nodes.size());
+        for (int id : originalIds) sorted.push_back(nodes[id]);
+        nodes.swap(sorted);
+	}
+
 	string getName() const {
         return name;
     }
@@ -82,4 +97,18 @@ public:
     vector<pair<double, double>> getNodes() const{
         return nodes;
     }
-};
\ No newline at end of file
+
+    /*
+     * Return the file position of every node, so that tours can be written with the original IDs
+     */
+    vector<int> getOriginalIds() const {
+        if (originalIds.empty()) {
+            vector<int> ids(nodes.size());
+            iota(ids.begin(), ids.end(), 0);
+            return ids;
+        }
+        return originalIds;
+    }
+};
+
+#endif // !PARSER_CLASS
\ No newline at end of file
@@ -0,0 +1,159 @@
+#ifndef PHEROMONE_CLASS
+#define PHEROMONE_CLASS
+
+#include "TSP.h"
+#include "NeighborLists.cpp"
+#include "ThreadPool.cpp"
+
+enum Precision {
+	DOUBLE_PRECISION,
+	SINGLE_PRECISION
+};
+
+/*
+	* Precision named on the command line: double or float
+*/
+inline Precision parsePrecision(string name) {
+	if (name.compare("double") == 0) return DOUBLE_PRECISION;
+	if (name.compare("float") == 0) return SINGLE_PRECISION;
+	cout << "Unknown precision " << name << ", use double or float\n";
+	exit(7);
+}
+
+/*
+	* Pheromone on the arcs of the graph, one row per leaving node.
+	* Dense: every row holds all nNodes arcs. Sparse: every row holds only the arcs towards the node's
+	* neighbor list, and one shared value stands for all the other arcs, so memory grows with n k instead of n^2.
+	* Rows are allocated uninitialized and filled on the pool, so every page is first touched by a worker.
+	* Next to the pheromone every arc keeps its choice info, pheromone times heuristic, which is all tour
+	* construction reads. It is kept in double or, to halve the bandwidth of construction, in float.
+*/
+class PheromoneStore {
+private:
+	int nNodes = 0;
+	int width = 0;								//	values per row: nNodes when dense, k when sparse
+	const NeighborLists *candidates = nullptr;	//	column of every sparse value, null when dense
+	unique_ptr<double[]> values;				//	nNodes x width, row major
+	double rest = 0.0;							//	pheromone on every arc outside the candidates
+	Precision precision = DOUBLE_PRECISION;
+	unique_ptr<double[]> doubleChoice;			//	choice info, same layout as values, DOUBLE_PRECISION only
+	unique_ptr<float[]> floatChoice;			//	SINGLE_PRECISION only
+public:
+	PheromoneStore() {}
+
+	/*
+		* Dense store, every arc set to value. Choice info is left to the caller.
+	*/
+	PheromoneStore(int n, double value, Precision p, ThreadPool &pool) : nNodes(n), width(n), rest(value), precision(p) {
+		fill(value, pool);
+	}
+
+	/*
+		* Sparse store on the arcs of lists, every arc set to value. Choice info is left to the caller.
+	*/
+	PheromoneStore(const NeighborLists &lists, double value, Precision p, ThreadPool &pool)
+		: nNodes(lists.nodes()), width(lists.size()), candidates(&lists), rest(value), precision(p) {
+		fill(value, pool);
+	}
+
+	PheromoneStore(PheromoneStore &&other) = default;
+	PheromoneStore &operator=(PheromoneStore &&other) = default;
+
+	bool isSparse() const {
+		return candidates != nullptr;
+	}
+
+	/*
+		* Number of values stored in every row
+	*/
+	int rowSize() const {
+		return width;
+	}
+
+	/*
+		* Node reached by the index-th arc of row i
+	*/
+	int column(int i, int index) const {
+		return candidates ? candidates->get(i, index) : index;
+	}
+
+	double *row(int i) {
+		return &values[(size_t) i * width];
+	}
+
+	const double *row(int i) const {
+		return &values[(size_t) i * width];
+	}
+
+	/*
+		* Return the index in row i of arc (i, j), or -1 if the arc is not stored and shares the rest value
+	*/
+	int indexOf(int i, int j) const {
+		if (!candidates) return j;
+		const int *list = candidates->of(i);
+		for (int c = 0; c < width; c++) {
+			if (list[c] == j) return c;
+		}
+		return -1;
+	}
+
+	/*
+		* Return the cell of arc (i, j), or nullptr if the arc is not stored
+	*/
+	double *find(int i, int j) {
+		int index = indexOf(i, j);
+		return (index < 0) ? nullptr : &values[(size_t) i * width + index];
+	}
+
+	double get(int i, int j) {
+		double *cell = find(i, j);
+		return cell ? *cell : rest;
+	}
+
+	/*
+		* Pheromone on every arc that is not stored
+	*/
+	double restValue() const {
+		return rest;
+	}
+
+	void setRest(double value) {
+		rest = value;
+	}
+
+	Precision getPrecision() const {
+		return precision;
+	}
+
+	void setChoice(int i, int index, double value) {
+		if (precision == SINGLE_PRECISION) floatChoice[(size_t) i * width + index] = (float) value;
+		else doubleChoice[(size_t) i * width + index] = value;
+	}
+
+	/*
+		* Choice info of row i, only in the matching precision
+	*/
+	const double *doubleChoices(int i) const {
+		return &doubleChoice[(size_t) i * width];
+	}
+
+	const float *floatChoices(int i) const {
+		return &floatChoice[(size_t) i * width];
+	}
+
+private:
+	void fill(double value, ThreadPool &pool) {
+		values.reset(new double[(size_t) nNodes * width]);
+		if (precision == SINGLE_PRECISION) floatChoice.reset(new float[(size_t) nNodes * width]);
+		else doubleChoice.reset(new double[(size_t) nNodes * width]);
+		pool.parallelFor(nNodes, 16, [&](int thread, int begin, int end) {
+			for (int i = begin; i < end; i++) {
+				double *cells = row(i);
+				for (int j = 0; j < width; j++) cells[j] = value;
+				for (int j = 0; j < width; j++) setChoice(i, j, 0.0);
+			}
+		});
+	}
+};
+
+#endif // !PHEROMONE_CLASS
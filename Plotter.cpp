@@ -1,43 +1,64 @@
+#ifndef PLOTTER_CLASS
+#define PLOTTER_CLASS
+
 #include "TSP.h"
+#include "Tour.cpp"
 extern "C" {
     #include "gnuplot_i.h"
 }
 
+//Most points sent to gnuplot for one plot, larger sets are downsampled
+constexpr auto PLOTLIMIT = (int) 5000;
+
+/*
+	* Live view of the cities and of the best tour. Points are streamed inline down the gnuplot pipe,
+	* with no temporary files, from coordinate buffers reused by every plot.
+	* Above limit points only every k-th city is drawn, so a plot costs O(limit) whatever the instance size.
+*/
 class Plotter {
 private:
     gnuplot_ctrl* gp;
+    int limit;
+    vector<double> x;
+    vector<double> y;
 public:
-    Plotter() {
+    Plotter(int maxPoints = PLOTLIMIT) : limit(max(2, maxPoints)) {
         gp = gnuplot_init();
         gnuplot_set_xlabel(gp, ( char * ) "X Coord" ) ;
         gnuplot_set_ylabel(gp, ( char * ) "Y Coord" ) ;
     }
-	void plotPoints(vector<pair<double, double>> nodes, int nnodes) {
+	void plotPoints(const vector<pair<double, double>> &nodes, int nnodes) {
         cout << "Plotting Points\n";
-        vector<double> x;
-        vector<double> y;
-        for (int i = 0; i < nnodes; i++) {
+        int stride = max(1, (nnodes + limit - 1) / limit);
+        x.clear();
+        y.clear();
+        for (int i = 0; i < nnodes; i += stride) {
             x.push_back(nodes[i].first);
             y.push_back(nodes[i].second);
         }
         gnuplot_setstyle(gp, ( char * ) "points" ) ;
-        gnuplot_plot_xy(gp, &x[0], &y[0], nnodes, "Points");
+        gnuplot_plot_xy_inline(gp, x.data(), y.data(), (int) x.size(), "Points");
 	}
-	void plotSolution(vector<pair<double, double>> nodes, vector<int> sol, int nnodes) {
+	void plotSolution(const vector<pair<double, double>> &nodes, const Tour &sol) {
         gnuplot_resetplot(gp);
         gnuplot_set_xlabel(gp, ( char * ) "X Coord" ) ;
         gnuplot_set_ylabel(gp, ( char * ) "Y Coord" ) ;
         cout << "Plotting Solution!\n";
-        vector<double> x;
-        vector<double> y;
-        for (int i = 0; i < nnodes; i++) {
-            int node = sol[i];
+        int nnodes = sol.size();
+        // The tour is drawn through every stride-th city in tour order, then closed
+        int stride = max(1, (nnodes + limit - 1) / limit);
+        x.clear();
+        y.clear();
+        for (int i = 0; i < nnodes; i += stride) {
+            int node = sol.node(i);
             x.push_back(nodes[node].first);
             y.push_back(nodes[node].second);
         }
-        x.push_back(nodes[sol[0]].first);
-        y.push_back(nodes[sol[0]].second);
-        gnuplot_setstyle(gp, ( char * ) "linespoints" ) ;
-        gnuplot_plot_xy(gp, &x[0], &y[0], (nnodes + 1), "Solution");
+        x.push_back(nodes[sol.node(0)].first);
+        y.push_back(nodes[sol.node(0)].second);
+        gnuplot_setstyle(gp, ( char * ) (stride > 1 ? "lines" : "linespoints") ) ;
+        gnuplot_plot_xy_inline(gp, x.data(), y.data(), (int) x.size(), "Solution");
 	}
-};
\ No newline at end of file
+};
+
+#endif // !PLOTTER_CLASS
@@ -0,0 +1,44 @@
+#ifndef PROBLEM_CLASS
+#define PROBLEM_CLASS
+
+#include "TSP.h"
+#include "Parser.cpp"
+#include "Distance.cpp"
+
+/*
+	* A parsed instance and its distance matrix. Read-only once loaded, so colonies solving
+	* the same file, even at the same time, can share one.
+*/
+struct Problem {
+	string name;
+	vector<pair<double, double>> nodes;
+	vector<int> originalIds;			//	file index of every node, nodes may be renumbered at load time
+	bool euc = true;
+	shared_ptr<const DistanceMatrix> distances;
+
+	int size() const {
+		return (int) nodes.size();
+	}
+
+	/*
+		* Parse file, renumber its nodes along curve and compute the distances on pool.
+		* Distances are computed on the fly if matrixFree is set or the instance has more than MAXMATRIXNODES cities.
+		* Throw LoadError if the file cannot be read or its problem is not supported.
+	*/
+	static shared_ptr<const Problem> load(string file, CurveType curve, bool matrixFree = false,
+										  ThreadPool &pool = ThreadPool::shared()) {
+		Parser p(file);
+		p.parse();
+		if (curve != NO_CURVE) p.reorder(curve);
+		shared_ptr<Problem> problem(new Problem());
+		problem->name = p.getName();
+		problem->nodes = p.getNodes();
+		problem->originalIds = p.getOriginalIds();
+		problem->euc = p.isEuc();
+		bool dense = !matrixFree && problem->size() <= MAXMATRIXNODES;
+		problem->distances.reset(new DistanceMatrix(problem->nodes, problem->euc, dense, pool));
+		return problem;
+	}
+};
+
+#endif // !PROBLEM_CLASS
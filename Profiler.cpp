@@ -0,0 +1,198 @@
+#ifndef PROFILER_CLASS
+#define PROFILER_CLASS
+
+#include "TSP.h"
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+
+enum ProfileStage { SETUP_STAGE, MOVE_STAGE, BEST_STAGE, UPDATE_STAGE, PROFILE_STAGES };
+
+enum ProfileCounter { SELECTIONS, EXPLOITATIONS, EXPLORATIONS, PHEROMONE_CELLS, ALLOCATIONS, PROFILE_COUNTERS };
+
+//Heap allocations seen by the operator new hook in AllocationCounter.cpp
+inline atomic<uint64_t> allocationCount(0);
+
+/*
+	* Per-iteration timers and counters of the solver hot path.
+	* Everything is reached through the PROFILE_* macros, which expand to nothing unless
+	* the program is built with ANTCOLONY_PROFILE.
+*/
+class Profiler {
+private:
+	// Counters of one thread, on a cache line of their own so that threads counting at once do not share it
+	struct alignas(64) ThreadCounters {
+		uint64_t values[PROFILE_COUNTERS] = {};
+	};
+
+	double stageTotal[PROFILE_STAGES] = {};
+	double stageIteration[PROFILE_STAGES] = {};
+	int foldedInto[PROFILE_STAGES] = {-1, -1, -1, -1};	//	stage whose timer covers this one, -1 if timed on its own
+	uint64_t counterTotal[PROFILE_COUNTERS] = {};
+	uint64_t counterIteration[PROFILE_COUNTERS] = {};
+	vector<ThreadCounters> threadCounters = vector<ThreadCounters>(1);	//	bumped by every thread, merged by endIteration
+	uint64_t allocationMark = 0;
+	int iterations = 0;
+	ofstream trace;
+	bool json = false;
+
+	static const char *stageName(int stage) {
+		static const char *names[PROFILE_STAGES] = {"setupAnts", "moveAnts", "updateBestTour", "globalUpdating"};
+		return names[stage];
+	}
+
+	static const char *counterName(int counter) {
+		static const char *names[PROFILE_COUNTERS] = {"selections", "exploitations", "explorations", "cells", "allocations"};
+		return names[counter];
+	}
+public:
+	/*
+		* Times the enclosing block and charges it to a stage
+	*/
+	class Scope {
+	private:
+		Profiler &profiler;
+		ProfileStage stage;
+		chrono::steady_clock::time_point start;
+	public:
+		Scope(Profiler &p, ProfileStage s) : profiler(p), stage(s), start(chrono::steady_clock::now()) {}
+		~Scope() {
+			profiler.stageIteration[stage] += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		}
+	};
+
+	/*
+		* Write one row per iteration to path: JSON lines if it ends with .json, CSV otherwise
+	*/
+	void openTrace(string path) {
+		json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+		trace.open(path);
+		if (!trace.is_open()) {
+			cout << "Unable to open trace file " << path << "\n";
+			return;
+		}
+		if (!json) {
+			trace << "iteration";
+			for (int s = 0; s < PROFILE_STAGES; s++) trace << "," << stageName(s);
+			for (int c = 0; c < PROFILE_COUNTERS; c++) trace << "," << counterName(c);
+			trace << ",best\n";
+		}
+	}
+
+	/*
+		* Work of stage runs inside the timed block of stage into, it has no time of its own:
+		* the trace leaves it empty and the report names the stage that holds it
+	*/
+	void fold(ProfileStage stage, ProfileStage into) {
+		foldedInto[stage] = into;
+	}
+
+	/*
+		* Counters for threads threads, numbered from 0 as the pool workers
+	*/
+	void setThreads(int threads) {
+		threadCounters.assign(max(1, threads), ThreadCounters());
+	}
+
+	void count(int thread, ProfileCounter counter, uint64_t n) {
+		threadCounters[thread].values[counter] += n;
+	}
+
+	void startIteration() {
+		allocationMark = allocationCount.load(memory_order_relaxed);
+	}
+
+	/*
+		* Close the current iteration: accumulate totals and emit its trace row
+	*/
+	void endIteration(int iter, double bestLength) {
+		for (auto &counters : threadCounters) {
+			for (int c = 0; c < PROFILE_COUNTERS; c++) {
+				counterIteration[c] += counters.values[c];
+				counters.values[c] = 0;
+			}
+		}
+		counterIteration[ALLOCATIONS] += allocationCount.load(memory_order_relaxed) - allocationMark;
+		if (trace.is_open()) {
+			if (json) {
+				trace << "{\"iteration\":" << iter;
+				for (int s = 0; s < PROFILE_STAGES; s++) {
+					trace << ",\"" << stageName(s) << "\":";
+					if (foldedInto[s] >= 0) trace << "null";
+					else trace << stageIteration[s];
+				}
+				for (int c = 0; c < PROFILE_COUNTERS; c++) trace << ",\"" << counterName(c) << "\":" << counterIteration[c];
+				trace << ",\"best\":" << bestLength << "}\n";
+			}
+			else {
+				trace << iter;
+				for (int s = 0; s < PROFILE_STAGES; s++) {
+					trace << ",";
+					if (foldedInto[s] < 0) trace << stageIteration[s];
+				}
+				for (int c = 0; c < PROFILE_COUNTERS; c++) trace << "," << counterIteration[c];
+				trace << "," << bestLength << "\n";
+			}
+		}
+		for (int s = 0; s < PROFILE_STAGES; s++) {
+			stageTotal[s] += stageIteration[s];
+			stageIteration[s] = 0.0;
+		}
+		for (int c = 0; c < PROFILE_COUNTERS; c++) {
+			counterTotal[c] += counterIteration[c];
+			counterIteration[c] = 0;
+		}
+		iterations++;
+	}
+
+	/*
+		* End-of-run summary
+	*/
+	void report(ostream &out) {
+		double total = 0.0;
+		for (int s = 0; s < PROFILE_STAGES; s++) total += stageTotal[s];
+		out << "Profile: " << iterations << " iterations, " << total << " s\n";
+		for (int s = 0; s < PROFILE_STAGES; s++) {
+			if (foldedInto[s] >= 0) {
+				out << "  " << left << setw(16) << stageName(s) << " within " << stageName(foldedInto[s]) << "\n" << right;
+				continue;
+			}
+			out << "  " << left << setw(16) << stageName(s) << right << fixed << setprecision(3)
+				<< setw(10) << stageTotal[s] << " s" << setw(8) << setprecision(1)
+				<< (total > 0 ? 100.0 * stageTotal[s] / total : 0.0) << " %" << setw(12) << setprecision(3)
+				<< (iterations > 0 ? 1000.0 * stageTotal[s] / iterations : 0.0) << " ms/iter\n";
+		}
+		out << defaultfloat << setprecision(6);
+		uint64_t selections = counterTotal[SELECTIONS];
+		out << "  selections: " << selections;
+		if (selections > 0) {
+			out << " (exploitation " << 100.0 * counterTotal[EXPLOITATIONS] / selections << " %, exploration "
+				<< 100.0 * counterTotal[EXPLORATIONS] / selections << " %, "
+				<< 1e9 * stageTotal[MOVE_STAGE] / selections << " ns/selection)";
+		}
+		out << "\n  pheromone cells touched: " << counterTotal[PHEROMONE_CELLS] << "\n";
+		out << "  allocations: " << counterTotal[ALLOCATIONS] << "\n";
+	}
+};
+
+#ifdef ANTCOLONY_PROFILE
+#define PROFILE_SCOPE(stage) Profiler::Scope profileScope(profiler, stage)
+#define PROFILE_THREADS(threads) profiler.setThreads(threads)
+#define PROFILE_FOLD(stage, into) profiler.fold(stage, into)
+#define PROFILE_COUNT(thread, counter, n) profiler.count(thread, counter, n)
+#define PROFILE_START_ITERATION() profiler.startIteration()
+#define PROFILE_END_ITERATION(iter, best) profiler.endIteration(iter, best)
+#define PROFILE_TRACE(path) profiler.openTrace(path)
+#define PROFILE_REPORT(out) profiler.report(out)
+#else
+#define PROFILE_SCOPE(stage)
+#define PROFILE_THREADS(threads)
+#define PROFILE_FOLD(stage, into)
+#define PROFILE_COUNT(thread, counter, n)
+#define PROFILE_START_ITERATION()
+#define PROFILE_END_ITERATION(iter, best)
+#define PROFILE_TRACE(path)
+#define PROFILE_REPORT(out)
+#endif
+
+#endif // !PROFILER_CLASS
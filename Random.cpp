@@ -0,0 +1,68 @@
+#ifndef RANDOM_CLASS
+#define RANDOM_CLASS
+
+#include "TSP.h"
+
+/*
+	* xoshiro256** generator. Every ant owns one, seeded from the colony seed and its own index,
+	* so a run is fully determined by the seed whatever the order the ants are processed in.
+*/
+class Random {
+private:
+	uint64_t state[4];
+
+	static uint64_t splitMix(uint64_t &x) {
+		uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+
+	static uint64_t rotl(uint64_t x, int k) {
+		return (x << k) | (x >> (64 - k));
+	}
+public:
+	Random(uint64_t seed = 1, uint64_t stream = 0) {
+		uint64_t x = seed ^ splitMix(stream);
+		for (int i = 0; i < 4; i++) state[i] = splitMix(x);
+	}
+
+	uint64_t next() {
+		uint64_t result = rotl(state[1] * 5, 7) * 9;
+		uint64_t t = state[1] << 17;
+		state[2] ^= state[0];
+		state[3] ^= state[1];
+		state[1] ^= state[2];
+		state[0] ^= state[3];
+		state[2] ^= t;
+		state[3] = rotl(state[3], 45);
+		return result;
+	}
+
+	/*
+		* The four state words, to checkpoint the stream and restore it with setState
+	*/
+	const uint64_t *getState() const {
+		return state;
+	}
+
+	void setState(const uint64_t *words) {
+		for (int i = 0; i < 4; i++) state[i] = words[i];
+	}
+
+	/*
+		* Uniform double in [0, 1)
+	*/
+	double uniform() {
+		return (next() >> 11) * 0x1.0p-53;
+	}
+
+	/*
+		* Uniform integer in [0, n)
+	*/
+	int below(int n) {
+		return (int) (((next() >> 32) * (uint64_t) n) >> 32);
+	}
+};
+
+#endif // !RANDOM_CLASS
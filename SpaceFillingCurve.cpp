@@ -0,0 +1,81 @@
+#ifndef SPACE_FILLING_CURVE
+#define SPACE_FILLING_CURVE
+
+#include "TSP.h"
+
+enum CurveType { NO_CURVE, HILBERT_CURVE, MORTON_CURVE };
+
+//Side of the grid the coordinates are quantized on before computing curve keys
+constexpr auto CURVEGRID = (uint32_t) 65536;
+
+/*
+	* Position of cell (x, y) along the Hilbert curve covering a CURVEGRID x CURVEGRID grid
+*/
+inline uint64_t hilbertKey(uint32_t x, uint32_t y) {
+    uint64_t d = 0;
+    for (uint32_t s = CURVEGRID / 2; s > 0; s /= 2) {
+        uint32_t rx = (x & s) > 0;
+        uint32_t ry = (y & s) > 0;
+        d += (uint64_t) s * s * ((3 * rx) ^ ry);
+        if (ry == 0) {
+            if (rx == 1) {
+                x = CURVEGRID - 1 - x;
+                y = CURVEGRID - 1 - y;
+            }
+            swap(x, y);
+        }
+    }
+    return d;
+}
+
+/*
+	* Position of cell (x, y) along the Morton (Z-order) curve: bits of x and y interleaved
+*/
+inline uint64_t mortonKey(uint32_t x, uint32_t y) {
+    uint64_t d = 0;
+    for (uint32_t bit = 0; (CURVEGRID >> bit) > 1; bit++) {
+        d |= (uint64_t) ((x >> bit) & 1) << (2 * bit);
+        d |= (uint64_t) ((y >> bit) & 1) << (2 * bit + 1);
+    }
+    return d;
+}
+
+/*
+	* Map a command line name to its curve
+*/
+inline CurveType parseCurve(string name) {
+    if (name.compare("none") == 0) return NO_CURVE;
+    if (name.compare("hilbert") == 0) return HILBERT_CURVE;
+    if (name.compare("morton") == 0) return MORTON_CURVE;
+    cout << "Unknown curve: " << name << "\n";
+    exit(7);
+}
+
+/*
+	* Return node indices sorted along the curve through their bounding box. O(n log n).
+*/
+inline vector<int> curveOrder(const vector<pair<double, double>> &nodes, CurveType curve = HILBERT_CURVE) {
+    int n = (int) nodes.size();
+    vector<int> order(n);
+    iota(order.begin(), order.end(), 0);
+    if (n == 0 || curve == NO_CURVE) return order;
+    double minX = DBL_MAX, minY = DBL_MAX, maxX = -DBL_MAX, maxY = -DBL_MAX;
+    for (auto &node : nodes) {
+        minX = min(minX, node.first);
+        maxX = max(maxX, node.first);
+        minY = min(minY, node.second);
+        maxY = max(maxY, node.second);
+    }
+    double scale = max(maxX - minX, maxY - minY);
+    scale = (scale > 0) ? (CURVEGRID - 1) / scale : 0.0;
+    vector<uint64_t> keys(n);
+    for (int i = 0; i < n; i++) {
+        auto x = (uint32_t) ((nodes[i].first - minX) * scale);
+        auto y = (uint32_t) ((nodes[i].second - minY) * scale);
+        keys[i] = (curve == MORTON_CURVE) ? mortonKey(x, y) : hilbertKey(x, y);
+    }
+    stable_sort(order.begin(), order.end(), [&keys](int a, int b) { return keys[a] < keys[b]; });
+    return order;
+}
+
+#endif // !SPACE_FILLING_CURVE
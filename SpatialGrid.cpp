@@ -0,0 +1,126 @@
+#ifndef SPATIAL_GRID_CLASS
+#define SPATIAL_GRID_CLASS
+
+#include "TSP.h"
+
+/*
+	* Uniform grid over the cities, like the one NeighborLists is built on, that keeps for every ant the cities
+	* it has not visited yet, cell by cell. A visit deletes the city from its cell in O(1), so the nearest
+	* unvisited city is found by a ring search that skips emptied cells, in time growing with its distance
+	* instead of with n. Planar distance ranks cities exactly only for EUC_2D, the grid is not meant for GEO.
+*/
+class SpatialGrid {
+private:
+	int nNodes = 0;
+	int side = 1;
+	int nCells = 1;
+	double cellSize = 1.0;
+	vector<int> cellOfNode;			//	cell of every city
+	vector<int> cellStart;			//	first slot of every cell
+	vector<int> cellItems;			//	cities grouped by cell, the layout every tour starts from
+	vector<int> itemSlot;			//	slot of every city in cellItems
+	vector<int> items;				//	nAnts x nNodes, row k is cellItems with the cities ant k visited moved to the end of their cell
+	vector<int> slots;				//	nAnts x nNodes, slot of every city in row k
+	vector<int> live;				//	nAnts x nCells, cities of every cell ant k has not visited
+public:
+	SpatialGrid() {}
+
+	SpatialGrid(const vector<pair<double, double>> &nodes, int ants) {
+		nNodes = (int) nodes.size();
+		double minX = DBL_MAX, minY = DBL_MAX, maxX = -DBL_MAX, maxY = -DBL_MAX;
+		for (auto &node : nodes) {
+			minX = min(minX, node.first);
+			maxX = max(maxX, node.first);
+			minY = min(minY, node.second);
+			maxY = max(maxY, node.second);
+		}
+		// About two nodes per cell
+		side = max(1, (int) sqrt(nNodes / 2.0));
+		nCells = side * side;
+		cellSize = max(maxX - minX, maxY - minY) / side;
+		if (cellSize <= 0) cellSize = 1.0;
+		auto cellOf = [&](double v, double lo) { return min(side - 1, (int) ((v - lo) / cellSize)); };
+
+		cellOfNode.resize(nNodes);
+		cellStart.assign(nCells + 1, 0);
+		for (int i = 0; i < nNodes; i++) {
+			cellOfNode[i] = cellOf(nodes[i].second, minY) * side + cellOf(nodes[i].first, minX);
+			cellStart[cellOfNode[i] + 1]++;
+		}
+		for (int c = 0; c < nCells; c++) cellStart[c + 1] += cellStart[c];
+		cellItems.resize(nNodes);
+		itemSlot.resize(nNodes);
+		vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+		for (int i = 0; i < nNodes; i++) {
+			itemSlot[i] = fill[cellOfNode[i]]++;
+			cellItems[itemSlot[i]] = i;
+		}
+		items.resize((size_t) ants * nNodes);
+		slots.resize((size_t) ants * nNodes);
+		live.resize((size_t) ants * nCells);
+	}
+
+	/*
+		* Every city unvisited again for ant k, in O(n)
+	*/
+	void reset(int k) {
+		copy(cellItems.begin(), cellItems.end(), items.begin() + (size_t) k * nNodes);
+		copy(itemSlot.begin(), itemSlot.end(), slots.begin() + (size_t) k * nNodes);
+		int *count = &live[(size_t) k * nCells];
+		for (int c = 0; c < nCells; c++) count[c] = cellStart[c + 1] - cellStart[c];
+	}
+
+	/*
+		* Ant k visited city: swap it past the last unvisited city of its cell
+	*/
+	void remove(int k, int city) {
+		int *row = &items[(size_t) k * nNodes];
+		int *slot = &slots[(size_t) k * nNodes];
+		int cell = cellOfNode[city];
+		int &count = live[(size_t) k * nCells + cell];
+		int last = cellStart[cell] + count - 1;
+		int at = slot[city];
+		if (at > last) return;
+		swap(row[at], row[last]);
+		slot[row[at]] = at;
+		slot[row[last]] = last;
+		count--;
+	}
+
+	/*
+		* Unvisited city of ant k nearest to city by distance(f), a TSPLIB EUC_2D distance, lowest index on ties.
+		* Rings of cells are searched outwards until no farther cell can hold a city as near. Return -1 if
+		* ant k has visited every city.
+	*/
+	template<typename Distance>
+	int nearest(int k, int city, Distance distance) const {
+		const int *row = &items[(size_t) k * nNodes];
+		const int *count = &live[(size_t) k * nCells];
+		int cx = cellOfNode[city] % side, cy = cellOfNode[city] / side;
+		int best = -1;
+		double bestDistance = DBL_MAX;
+		for (int r = 0; r <= side; r++) {
+			// Rounding to the nearest integer can bring a city at most 0.5 nearer
+			if (best != -1 && max(0, r - 1) * cellSize > bestDistance + 0.5) break;
+			for (int y = cy - r; y <= cy + r; y++) {
+				if (y < 0 || y >= side) continue;
+				bool border = (y == cy - r || y == cy + r);
+				for (int x = cx - r; x <= cx + r; x += (border || r == 0) ? 1 : 2 * r) {
+					if (x < 0 || x >= side) continue;
+					int cell = y * side + x;
+					for (int s = cellStart[cell]; s < cellStart[cell] + count[cell]; s++) {
+						int f = row[s];
+						double d = distance(f);
+						if (d < bestDistance || (d == bestDistance && f < best)) {
+							bestDistance = d;
+							best = f;
+						}
+					}
+				}
+			}
+		}
+		return best;
+	}
+};
+
+#endif // !SPATIAL_GRID_CLASS
@@ -0,0 +1,92 @@
+#ifndef SUM_TREE_CLASS
+#define SUM_TREE_CLASS
+
+#include "TSP.h"
+
+enum SamplerType {
+	AUTO_SAMPLER,
+	LINEAR_SAMPLER,
+	TREE_SAMPLER
+};
+
+/*
+	* Sampler named on the command line: auto, linear or tree
+*/
+inline SamplerType parseSampler(string name) {
+	if (name.compare("auto") == 0) return AUTO_SAMPLER;
+	if (name.compare("linear") == 0) return LINEAR_SAMPLER;
+	if (name.compare("tree") == 0) return TREE_SAMPLER;
+	cout << "Unknown sampler " << name << ", use auto, linear or tree\n";
+	exit(7);
+}
+
+/*
+	* One Fenwick tree per row over rows x width non-negative weights: the total of a row, the change of
+	* one weight and the search of the weight a running sum falls on all take O(log width).
+*/
+class SumTree {
+private:
+	int rows = 0;
+	int width = 0;
+	int top = 0;					//	highest power of two not above width, first step of find
+	unique_ptr<double[]> sums;		//	rows x width, row major, node k of the tree of row i at k - 1
+	unique_ptr<double[]> totals;	//	sum of every row
+public:
+	SumTree() {}
+
+	SumTree(int nRows, int rowWidth) : rows(nRows), width(rowWidth) {
+		sums.reset(new double[(size_t) rows * width]);
+		totals.reset(new double[rows]);
+		top = 1;
+		while (2 * top <= width) top *= 2;
+	}
+
+	/*
+		* Rebuild row i from weight(j) for j in [0, width), in O(width)
+	*/
+	template<typename Weight>
+	void build(int i, Weight weight) {
+		double *tree = &sums[(size_t) i * width];
+		double total = 0.0;
+		for (int j = 0; j < width; j++) {
+			tree[j] = weight(j);
+			total += tree[j];
+		}
+		for (int k = 1; k <= width; k++) {
+			int parent = k + (k & -k);
+			if (parent <= width) tree[parent - 1] += tree[k - 1];
+		}
+		totals[i] = total;
+	}
+
+	/*
+		* Add delta to the weight of column j of row i
+	*/
+	void add(int i, int j, double delta) {
+		double *tree = &sums[(size_t) i * width];
+		for (int k = j + 1; k <= width; k += k & -k) tree[k - 1] += delta;
+		totals[i] += delta;
+	}
+
+	double total(int i) const {
+		return totals[i];
+	}
+
+	/*
+		* Column of row i whose weight holds the running sum r, in [0, total(i)): the first column whose
+		* prefix sum exceeds r. Columns of weight 0 are never returned.
+	*/
+	int find(int i, double r) const {
+		const double *tree = &sums[(size_t) i * width];
+		int position = 0;
+		for (int step = top; step > 0; step /= 2) {
+			if (position + step <= width && tree[position + step - 1] <= r) {
+				position += step;
+				r -= tree[position - 1];
+			}
+		}
+		return min(position, width - 1);
+	}
+};
+
+#endif // !SUM_TREE_CLASS
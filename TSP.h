@@ -15,7 +15,25 @@
 #include <vector>
 #include <string>
 #include <utility>
+#include <algorithm>
+#include <numeric>
+#include <cfloat>
+#include <cstdint>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
 
 using namespace std;
 
+/*
+	* A problem file that cannot be loaded. code is the exit code of a single run: 1 unreadable,
+	* 5 not a TSP, 6 unsupported edge weights, 9 distances too long.
+*/
+class LoadError : public runtime_error {
+public:
+	int code;
+
+	LoadError(const string &message, int exitCode) : runtime_error(message), code(exitCode) {}
+};
+
 #endif //ANTCOLONY_TSP_H
@@ -0,0 +1,256 @@
+#ifndef THREAD_POOL_CLASS
+#define THREAD_POOL_CLASS
+
+#include "TSP.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <functional>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+//Chunks every worker receives from a parallelFor before stealing starts
+constexpr auto CHUNKSPERWORKER = (int) 8;
+
+/*
+	* Work-stealing pool shared by the whole process, created on first use.
+	* parallelFor cuts a range into chunks dealt to the workers' deques in contiguous blocks; every worker
+	* pops its own chunks from the back and, once out of work, steals from the front of the others.
+	* The calling thread takes part as worker 0. Calls made from inside a worker run inline.
+*/
+class ThreadPool {
+private:
+	struct Worker {
+		mutex lock;
+		deque<pair<int, int>> chunks;
+	};
+
+	vector<unique_ptr<Worker>> workers;
+	vector<thread> threads;
+	vector<int> cpus;			//	CPU every worker is pinned to, -1 if not pinned
+	atomic<bool> stealing{true};	//	false while runOnEveryWorker keeps every chunk on its owner
+	function<void(int, int, int)> job;
+	atomic<int> pending{0};
+	int generation = 0;
+	bool stopping = false;
+	mutex stateLock;
+	mutex submitLock;
+	condition_variable wake;
+
+	static int &configuredThreads() {
+		static int threads = 0;
+		return threads;
+	}
+
+	static bool &configuredAffinity() {
+		static bool affinity = false;
+		return affinity;
+	}
+
+	static int &currentWorker() {
+		thread_local int worker = -1;
+		return worker;
+	}
+
+	ThreadPool(int nThreads, bool affinity) {
+#ifndef __linux__
+		affinity = false;
+#endif
+		vector<int> allowed = affinity ? allowedCpus() : vector<int>();
+		for (int w = 0; w < nThreads; w++) {
+			workers.emplace_back(new Worker());
+			cpus.push_back(allowed.empty() ? -1 : allowed[w % allowed.size()]);
+		}
+		if (affinity) pin(cpus[0]);
+		for (int w = 1; w < nThreads; w++) {
+			threads.emplace_back([this, w]() {
+				if (cpus[w] >= 0) pin(cpus[w]);
+				loop(w);
+			});
+		}
+	}
+
+	/*
+		* CPUs the process may run on, in increasing order. Empty if they cannot be read.
+	*/
+	static vector<int> allowedCpus() {
+		vector<int> allowed;
+#ifdef __linux__
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		if (sched_getaffinity(0, sizeof(set), &set) != 0) return allowed;
+		for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+			if (CPU_ISSET(cpu, &set)) allowed.push_back(cpu);
+		}
+#endif
+		return allowed;
+	}
+
+	/*
+		* Bind the calling thread to one CPU
+	*/
+	static void pin(int cpu) {
+#ifdef __linux__
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+		pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+	}
+
+	void loop(int self) {
+		currentWorker() = self;
+		int seen = 0;
+		while (true) {
+			{
+				unique_lock<mutex> guard(stateLock);
+				wake.wait(guard, [&]() { return stopping || generation != seen; });
+				if (stopping) return;
+				seen = generation;
+			}
+			while (pending.load() > 0) {
+				if (!runChunk(self)) this_thread::yield();
+			}
+		}
+	}
+
+	/*
+		* Run one chunk, own work first then stolen. Return false if every deque is empty.
+	*/
+	bool runChunk(int self) {
+		pair<int, int> chunk;
+		bool found = false;
+		for (int i = 0; i < (stealing ? (int) workers.size() : 1) && !found; i++) {
+			Worker &victim = *workers[(self + i) % workers.size()];
+			lock_guard<mutex> guard(victim.lock);
+			if (victim.chunks.empty()) continue;
+			if (i == 0) {
+				chunk = victim.chunks.back();
+				victim.chunks.pop_back();
+			}
+			else {
+				chunk = victim.chunks.front();
+				victim.chunks.pop_front();
+			}
+			found = true;
+		}
+		if (!found) return false;
+		job(self, chunk.first, chunk.second);
+		pending.fetch_sub(1);
+		return true;
+	}
+public:
+	~ThreadPool() {
+		{
+			lock_guard<mutex> guard(stateLock);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (auto &t : threads) t.join();
+	}
+
+	/*
+		* Thread count (0 means one per hardware thread) and CPU pinning of the pool.
+		* Only effective before the first call to shared().
+	*/
+	static void configure(int threads, bool affinity) {
+		configuredThreads() = threads;
+		configuredAffinity() = affinity;
+	}
+
+	static ThreadPool &shared() {
+		static ThreadPool pool(configuredThreads() > 0 ? configuredThreads() : max(1, (int) thread::hardware_concurrency()),
+							   configuredAffinity());
+		return pool;
+	}
+
+	int size() const {
+		return (int) workers.size();
+	}
+
+	/*
+		* Workers a parallelFor called from here would run on: 1 inside a worker, where calls run inline
+	*/
+	int parallelism() const {
+		return currentWorker() >= 0 ? 1 : size();
+	}
+
+	/*
+		* Return the CPU worker is pinned to, -1 if the pool is not pinned
+	*/
+	int cpuOf(int worker) const {
+		return cpus[worker];
+	}
+
+	/*
+		* Run body(worker) exactly once on every worker thread, e.g. to first-touch memory from each of them
+	*/
+	void runOnEveryWorker(const function<void(int)> &body) {
+		if (size() == 1 || currentWorker() >= 0) {
+			for (int w = 0; w < size(); w++) body(w);
+			return;
+		}
+		lock_guard<mutex> submit(submitLock);
+		currentWorker() = 0;
+		{
+			lock_guard<mutex> guard(stateLock);
+			job = [&body](int worker, int begin, int end) { body(worker); };
+			// Workers still draining the last call may pick up a chunk as soon as it is pushed:
+			// the count and the no-stealing rule must be in place before
+			stealing = false;
+			pending = size();
+			for (int w = 0; w < size(); w++) {
+				lock_guard<mutex> ownerGuard(workers[w]->lock);
+				workers[w]->chunks.push_back(make_pair(w, w + 1));
+			}
+			generation++;
+		}
+		wake.notify_all();
+		while (pending.load() > 0) {
+			if (!runChunk(0)) this_thread::yield();
+		}
+		stealing = true;
+		currentWorker() = -1;
+	}
+
+	/*
+		* Run body(worker, begin, end) over [0, n) in chunks of at least grain items.
+		* worker is in [0, size()) and no two chunks run on the same worker at once.
+	*/
+	void parallelFor(int n, int grain, const function<void(int, int, int)> &body) {
+		if (n <= 0) return;
+		int nWorkers = size();
+		int chunkSize = max(max(1, grain), n / (nWorkers * CHUNKSPERWORKER));
+		int nChunks = (n + chunkSize - 1) / chunkSize;
+		if (nWorkers == 1 || nChunks == 1 || currentWorker() >= 0) {
+			body(0, 0, n);
+			return;
+		}
+		lock_guard<mutex> submit(submitLock);
+		currentWorker() = 0;
+		{
+			lock_guard<mutex> guard(stateLock);
+			job = body;
+			// Set before the first push, see runOnEveryWorker
+			pending = nChunks;
+			for (int c = 0; c < nChunks; c++) {
+				Worker &owner = *workers[(long) c * nWorkers / nChunks];
+				lock_guard<mutex> ownerGuard(owner.lock);
+				// Owners pop from the back: push reversed so that they walk their block in order
+				owner.chunks.push_front(make_pair(c * chunkSize, min(n, (c + 1) * chunkSize)));
+			}
+			generation++;
+		}
+		wake.notify_all();
+		while (pending.load() > 0) {
+			if (!runChunk(0)) this_thread::yield();
+		}
+		currentWorker() = -1;
+	}
+};
+
+#endif // !THREAD_POOL_CLASS
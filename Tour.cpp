@@ -0,0 +1,205 @@
+#ifndef TOUR_CLASS
+#define TOUR_CLASS
+
+#include "TSP.h"
+
+/*
+	* Tour stored as visiting order plus position of every city, so successor, predecessor, membership
+	* and edge queries are O(1). Indices are kept in 16 bits when the instance allows it.
+	* A city belongs to the tour only if pos and order agree on it: clear() is O(1) and a partial
+	* tour built by an ant doubles as its visited set.
+	* A tour either owns its arrays or is a view on arrays owned by someone else, e.g. one row of the
+	* colony-wide ant population block. Copies, and tours assigned from a view, always own their arrays.
+*/
+class Tour {
+private:
+	int length = 0;
+	int capacity = 0;
+	bool narrow = true;
+	vector<uint16_t> smallStorage;		//	order then pos, when owned
+	vector<int32_t> storage;
+	uint16_t *smallOrder = nullptr, *smallPos = nullptr;
+	int32_t *order = nullptr, *pos = nullptr;
+
+	void allocate(int nCities) {
+		capacity = nCities;
+		narrow = nCities <= 65536;
+		if (narrow) {
+			smallStorage.assign(2 * (size_t) nCities, 0);
+			smallOrder = smallStorage.data();
+			smallPos = smallOrder + nCities;
+		}
+		else {
+			storage.assign(2 * (size_t) nCities, 0);
+			order = storage.data();
+			pos = order + nCities;
+		}
+	}
+
+	template<typename Index>
+	void reverse(Index *cities, Index *positions, int first, int count) {
+		for (int k = 0; k < count / 2; k++) {
+			int a = (first + k) % length;
+			int b = (first + count - 1 - k) % length;
+			swap(cities[a], cities[b]);
+			positions[cities[a]] = (Index) a;
+			positions[cities[b]] = (Index) b;
+		}
+	}
+public:
+	Tour(int nCities = 0) {
+		allocate(nCities);
+	}
+
+	/*
+		* View on external order and position arrays of nCities entries, the first size cities in the tour
+	*/
+	Tour(uint16_t *orderArray, uint16_t *posArray, int nCities, int size)
+		: length(size), capacity(nCities), narrow(true), smallOrder(orderArray), smallPos(posArray) {}
+
+	Tour(int32_t *orderArray, int32_t *posArray, int nCities, int size)
+		: length(size), capacity(nCities), narrow(false), order(orderArray), pos(posArray) {}
+
+	Tour(const Tour &other) {
+		allocate(other.capacity);
+		*this = other;
+	}
+
+	/*
+		* Copy the cities of other, into the arrays this tour already uses if they have the same size
+	*/
+	Tour &operator=(const Tour &other) {
+		if (this == &other) return *this;
+		if (capacity != other.capacity || narrow != other.narrow) allocate(other.capacity);
+		length = other.length;
+		if (narrow) {
+			copy(other.smallOrder, other.smallOrder + capacity, smallOrder);
+			copy(other.smallPos, other.smallPos + capacity, smallPos);
+		}
+		else {
+			copy(other.order, other.order + capacity, order);
+			copy(other.pos, other.pos + capacity, pos);
+		}
+		return *this;
+	}
+
+	Tour(Tour &&other) {
+		*this = move(other);
+	}
+
+	/*
+		* Take over the arrays of other if it owns them, the vectors' buffers and so the pointers stay valid.
+		* A view is copied instead, so that assigning one never aliases this tour to someone else's arrays.
+	*/
+	Tour &operator=(Tour &&other) {
+		if (this == &other) return *this;
+		if (other.smallStorage.empty() && other.storage.empty()) return *this = other;
+		length = other.length;
+		capacity = other.capacity;
+		narrow = other.narrow;
+		smallStorage = move(other.smallStorage);
+		storage = move(other.storage);
+		smallOrder = other.smallOrder;
+		smallPos = other.smallPos;
+		order = other.order;
+		pos = other.pos;
+		other.allocate(0);
+		other.length = 0;
+		return *this;
+	}
+
+	/*
+		* Number of cities currently in the tour
+	*/
+	int size() const {
+		return length;
+	}
+
+	/*
+		* Return the city in position index
+	*/
+	int node(int index) const {
+		return narrow ? smallOrder[index] : order[index];
+	}
+
+	/*
+		* Return the position of city, meaningful only if contains(city)
+	*/
+	int position(int city) const {
+		return narrow ? smallPos[city] : pos[city];
+	}
+
+	bool contains(int city) const {
+		int index = position(city);
+		return index < length && node(index) == city;
+	}
+
+	/*
+		* Next city after city, wrapping around the end
+	*/
+	int succ(int city) const {
+		int index = position(city) + 1;
+		return node(index == length ? 0 : index);
+	}
+
+	/*
+		* Previous city before city, wrapping around the start
+	*/
+	int pred(int city) const {
+		int index = position(city);
+		return node(index == 0 ? length - 1 : index - 1);
+	}
+
+	/*
+		* Return true if node1 and node2 are adjacent in the tour
+	*/
+	bool hasEdge(int node1, int node2) const {
+		return contains(node1) && (succ(node1) == node2 || pred(node1) == node2);
+	}
+
+	void append(int city) {
+		if (narrow) {
+			smallOrder[length] = (uint16_t) city;
+			smallPos[city] = (uint16_t) length;
+		}
+		else {
+			order[length] = city;
+			pos[city] = length;
+		}
+		length++;
+	}
+
+	void clear() {
+		length = 0;
+	}
+
+	void assign(const vector<int> &cities) {
+		clear();
+		for (int city : cities) append(city);
+	}
+
+	/*
+		* Reverse the cities from position first to position last, walking forward and wrapping around.
+		* The shorter side of the cycle is reversed: the tour stays the same cycle, possibly flipped.
+		* Only for complete tours.
+	*/
+	void reverse(int first, int last) {
+		int inner = (last - first + length) % length + 1;
+		if (2 * inner > length) {
+			int next = (last + 1) % length;
+			last = (first - 1 + length) % length;
+			first = next;
+			inner = length - inner;
+		}
+		if (narrow) reverse(smallOrder, smallPos, first, inner);
+		else reverse(order, pos, first, inner);
+	}
+
+	vector<int> toVector() const {
+		vector<int> cities(length);
+		for (int i = 0; i < length; i++) cities[i] = node(i);
+		return cities;
+	}
+};
+
+#endif // !TOUR_CLASS
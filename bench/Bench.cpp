@@ -0,0 +1,320 @@
+#include "../TSP.h"
+#include "../AntColony.cpp"
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <random>
+
+//Minimum time spent measuring every microbenchmark
+constexpr auto MINBENCHTIME = (double) 0.2;
+
+//Seed of the synthetic instances and of the solver
+constexpr auto INSTANCESEED = (unsigned) 12345;
+
+//Side of the square the synthetic cities are drawn in
+constexpr auto INSTANCESIDE = (double) 1000000.0;
+
+//Seeds of the precision validation runs
+constexpr auto VALIDATIONSEEDS = (int) 5;
+
+//Largest relative loss of mean tour length allowed to single precision
+constexpr auto VALIDATIONTOLERANCE = (double) 0.01;
+
+/*
+	* Synthetic TSPLIB instance written to the temporary directory
+*/
+struct Instance {
+	string name;
+	string path;
+	vector<pair<double, double>> nodes;
+};
+
+/*
+	* Microbenchmarks of the solver kernels and macro benchmarks of whole solve() runs.
+	* Friend of AntColony so that private stages can be timed in isolation.
+*/
+class Bench {
+public:
+	/*
+		* Cities drawn uniformly in the square
+	*/
+	static Instance uniform(int n, unsigned seed = INSTANCESEED) {
+		mt19937 gen(seed);
+		uniform_real_distribution<double> coord(0.0, INSTANCESIDE);
+		Instance instance;
+		instance.name = "uniform" + to_string(n);
+		for (int i = 0; i < n; i++) instance.nodes.push_back(make_pair(coord(gen), coord(gen)));
+		write(instance);
+		return instance;
+	}
+
+	/*
+		* Cities drawn around n/100 + 1 gaussian centers
+	*/
+	static Instance clustered(int n, unsigned seed = INSTANCESEED) {
+		mt19937 gen(seed);
+		uniform_real_distribution<double> coord(0.0, INSTANCESIDE);
+		normal_distribution<double> spread(0.0, INSTANCESIDE / 50);
+		int clusters = n / 100 + 1;
+		vector<pair<double, double>> centers;
+		for (int c = 0; c < clusters; c++) centers.push_back(make_pair(coord(gen), coord(gen)));
+		Instance instance;
+		instance.name = "clustered" + to_string(n);
+		for (int i = 0; i < n; i++) {
+			auto &center = centers[gen() % clusters];
+			instance.nodes.push_back(make_pair(center.first + spread(gen), center.second + spread(gen)));
+		}
+		write(instance);
+		return instance;
+	}
+
+	/*
+		* Average nanoseconds per call of op, repeated until MINBENCHTIME seconds have passed
+	*/
+	template<typename Op>
+	static double nsPerOp(Op op) {
+		long calls = 0;
+		auto start = chrono::steady_clock::now();
+		double elapsed = 0.0;
+		do {
+			op();
+			calls++;
+			elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		} while (elapsed < MINBENCHTIME);
+		return 1e9 * elapsed / calls;
+	}
+
+	static void report(string name, int n, double ns) {
+		cout << left << setw(28) << name << right << setw(8) << n << fixed << setprecision(1) << setw(16) << ns
+			 << " ns/op\n" << defaultfloat;
+	}
+
+	static SolverOptions quietOptions() {
+		SolverOptions options;
+		options.plot = false;
+		options.verbose = false;
+		options.seed = INSTANCESEED;
+		return options;
+	}
+
+	static void micro() {
+		cout << left << setw(28) << "benchmark" << right << setw(8) << "cities" << setw(22) << "time\n";
+
+		Instance instance = uniform(1000);
+		auto &nodes = instance.nodes;
+		volatile double sink = 0.0;
+		size_t index = 0;
+		report("distance/euc", 1000, nsPerOp([&]() {
+			sink = sink + tspDistance(nodes[index % 1000], nodes[(index * 7 + 1) % 1000], true);
+			index++;
+		}));
+		vector<pair<double, double>> geo;
+		for (auto &node : nodes) geo.push_back(make_pair(node.first / INSTANCESIDE * 80, node.second / INSTANCESIDE * 160));
+		report("distance/geo", 1000, nsPerOp([&]() {
+			sink = sink + tspDistance(geo[index % 1000], geo[(index * 7 + 1) % 1000], false);
+			index++;
+		}));
+
+		DistanceMatrix matrix(nodes, true);
+		report("distance/matrix", 1000, nsPerOp([&]() {
+			sink = sink + matrix.get(index % 1000, (index * 7 + 1) % 1000);
+			index++;
+		}));
+		DistanceMatrix geoFree(geo, false, false);
+		report("distance/geo/matrixfree", 1000, nsPerOp([&]() {
+			sink = sink + geoFree.get(index % 1000, (index * 7 + 1) % 1000);
+			index++;
+		}));
+
+		// 1000 uniforms per call, about what an ant draws over a 1000 city tour
+		Random random(INSTANCESEED);
+		report("random/uniform", 1000, nsPerOp([&]() {
+			double sum = 0.0;
+			for (int i = 0; i < 1000; i++) sum += random.uniform();
+			sink = sink + sum;
+		}));
+
+		report("parser", 10000, nsPerOp([&, path = uniform(10000).path]() {
+			Parser p(path);
+			p.parse();
+		}));
+
+		SolverOptions options = quietOptions();
+		options.ants = 1;
+		AntColony colony(instance.path, options);
+		colony.clearTrails();
+		colony.setupAnts();
+		report("selection/selectNextNode", 1000, nsPerOp([&]() {
+			sink = sink + colony.selectNextNode(0, 0);
+		}));
+		report("sampler/probabilities", 1000, nsPerOp([&]() {
+			colony.calculateProbabilities(0, 0);
+		}));
+
+		// Exploration moves over whole tours, late steps included: time per move of both samplers, behind TREESAMPLERNODES
+		for (int n : {250, 500, 1000, 2000, 4000}) {
+			Instance sized = uniform(n);
+			for (SamplerType sampler : {LINEAR_SAMPLER, TREE_SAMPLER}) {
+				SolverOptions sampling = quietOptions();
+				sampling.ants = 1;
+				sampling.sampler = sampler;
+				AntColony tours(sized.path, sampling);
+				tours.clearTrails();
+				double ns = nsPerOp([&]() {
+					tours.setupAnts();
+					for (int s = 1; s < n; s++) {
+						tours.ants.visitNode(0, tours.rowSums ? tours.sampleTree(0, 0) : tours.sampleRow(0, 0), *tours.distances);
+					}
+				});
+				report(sampler == TREE_SAMPLER ? "sampler/tree" : "sampler/linear", n, ns / (n - 1));
+			}
+		}
+
+		// Nearest unvisited city of an ant with 90% of its tour done, as when sparse trails run out of candidates
+		Instance large = uniform(20000);
+		DistanceMatrix largeDistances(large.nodes, true, false);
+		SpatialGrid grid(large.nodes, 1);
+		grid.reset(0);
+		vector<char> visited(20000, 0);
+		Random order(INSTANCESEED);
+		for (int v = 0; v < 18000; v++) {
+			int city = order.below(20000);
+			visited[city] = 1;
+			grid.remove(0, city);
+		}
+		report("selection/nearest/grid", 20000, nsPerOp([&]() {
+			int from = (int) (index++ % 20000);
+			sink = sink + grid.nearest(0, from, [&](int f) { return largeDistances.get(from, f); });
+		}));
+		report("selection/nearest/scan", 20000, nsPerOp([&]() {
+			int from = (int) (index++ % 20000);
+			int best = -1;
+			double bestDistance = DBL_MAX;
+			for (int f = 0; f < 20000; f++) {
+				double d = largeDistances.get(from, f);
+				if (!visited[f] && d < bestDistance) {
+					bestDistance = d;
+					best = f;
+				}
+			}
+			sink = sink + best;
+		}));
+
+		NeighborLists neighbors(nodes, true);
+		LocalSearch search(matrix, neighbors);
+		Tour start(1000);
+		start.assign(InitialTour(nodes, true).build(HILBERT_TOUR));
+		report("localsearch/twoOpt", 1000, nsPerOp([&]() {
+			Tour tour = start;
+			sink = sink + search.twoOpt(tour);
+		}));
+
+		Instance small = uniform(200);
+		options.ants = 25;
+		AntColony updating(small.path, options);
+		updating.clearTrails();
+		updating.setupAnts();
+		updating.moveAnts();
+		updating.updateBestTour();
+		report("pheromone/globalUpdating", 200, nsPerOp([&]() {
+			updating.globalUpdating();
+		}));
+	}
+
+	/*
+		* Full solve() runs with a fixed colony of 25 ants. Quality is the best length over the greedy tour length.
+	*/
+	static void macro(int maxCities) {
+		cout << left << setw(18) << "instance" << right << setw(8) << "cities" << setw(8) << "iters" << setw(12)
+			 << "iters/s" << setw(14) << "ns/select" << setw(14) << "best" << setw(12) << "vs greedy" << "\n";
+		for (int n : {100, 1000, 5000, 20000}) {
+			if (n > maxCities) break;
+			for (int clusteredKind = 0; clusteredKind < 2; clusteredKind++) {
+				Instance instance = clusteredKind ? clustered(n) : uniform(n);
+				InitialTour greedy(instance.nodes, true);
+				double greedyLength = greedy.length(greedy.build(GREEDY_TOUR));
+
+				SolverOptions options = quietOptions();
+				options.ants = 25;
+				options.maxIterations = max(2, 20000 / n);
+				AntColony colony(instance.path, options);
+				auto start = chrono::steady_clock::now();
+				colony.solve();
+				double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+				double selections = (double) options.ants * (n - 1) * options.maxIterations;
+
+				cout << left << setw(18) << instance.name << right << setw(8) << n << setw(8) << options.maxIterations
+					 << fixed << setprecision(2) << setw(12) << options.maxIterations / elapsed
+					 << setprecision(1) << setw(14) << 1e9 * elapsed / selections
+					 << setprecision(0) << setw(14) << colony.getBestTourLength()
+					 << setprecision(3) << setw(12) << colony.getBestTourLength() / greedyLength << "\n" << defaultfloat;
+			}
+		}
+	}
+
+	/*
+		* Solve uniform and clustered instances with seeds 1..VALIDATIONSEEDS in double and in single precision.
+		* Return false if the single precision mean length is more than VALIDATIONTOLERANCE worse on any instance.
+	*/
+	static bool validate(int maxCities) {
+		cout << left << setw(18) << "instance" << right << setw(8) << "cities" << setw(14) << "double" << setw(14)
+			 << "float" << setw(12) << "change" << setw(10) << "speedup" << "\n";
+		bool passed = true;
+		for (int n : {200, 1000, 5000}) {
+			if (n > maxCities) break;
+			for (int clusteredKind = 0; clusteredKind < 2; clusteredKind++) {
+				Instance instance = clusteredKind ? clustered(n) : uniform(n);
+				double length[2] = {0.0, 0.0};
+				double elapsed[2] = {0.0, 0.0};
+				for (int precision = 0; precision < 2; precision++) {
+					for (int seed = 1; seed <= VALIDATIONSEEDS; seed++) {
+						SolverOptions options = quietOptions();
+						options.ants = 25;
+						options.maxIterations = max(5, 20000 / n);
+						options.seed = seed;
+						options.precision = precision ? SINGLE_PRECISION : DOUBLE_PRECISION;
+						AntColony colony(instance.path, options);
+						auto start = chrono::steady_clock::now();
+						colony.solve();
+						elapsed[precision] += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+						length[precision] += colony.getBestTourLength() / VALIDATIONSEEDS;
+					}
+				}
+				double change = length[1] / length[0] - 1;
+				if (change > VALIDATIONTOLERANCE) passed = false;
+				cout << left << setw(18) << instance.name << right << setw(8) << n << fixed << setprecision(0)
+					 << setw(14) << length[0] << setw(14) << length[1] << setprecision(2) << setw(11) << 100 * change
+					 << "%" << setw(9) << elapsed[0] / elapsed[1] << "x" << (change > VALIDATIONTOLERANCE ? "  FAIL" : "")
+					 << "\n" << defaultfloat;
+			}
+		}
+		cout << (passed ? "Single precision within " : "Single precision NOT within ") << 100 * VALIDATIONTOLERANCE
+			 << "% of double precision\n";
+		return passed;
+	}
+
+private:
+	static void write(Instance &instance) {
+		instance.path = (filesystem::temp_directory_path() / (instance.name + ".tsp")).string();
+		ofstream file(instance.path);
+		file << "NAME: " << instance.name << "\nTYPE: TSP\nDIMENSION: " << instance.nodes.size()
+			 << "\nEDGE_WEIGHT_TYPE: EUC_2D\nNODE_COORD_SECTION\n" << setprecision(10);
+		for (size_t i = 0; i < instance.nodes.size(); i++) {
+			file << i + 1 << " " << instance.nodes[i].first << " " << instance.nodes[i].second << "\n";
+		}
+		file << "EOF\n";
+	}
+};
+
+/*
+	* Usage: bench [micro|macro|validate|all] [max cities of the macro and validate runs, default 5000]
+	* validate is not part of all, it exits with 1 if single precision fails its guardrail.
+*/
+int main(int argc, char** argv) {
+	string mode = (argc > 1) ? argv[1] : "all";
+	int maxCities = (argc > 2) ? stoi(argv[2]) : 5000;
+	if (mode.compare("micro") == 0 || mode.compare("all") == 0) Bench::micro();
+	if (mode.compare("macro") == 0 || mode.compare("all") == 0) Bench::macro(maxCities);
+	if (mode.compare("validate") == 0) return Bench::validate(maxCities) ? 0 : 1;
+	return 0;
+}
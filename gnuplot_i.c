@@ -430,6 +430,33 @@ void gnuplot_plot_xy(
 
 
 
+void gnuplot_plot_xy_inline(
+    gnuplot_ctrl    *   handle,
+    double const    *   x,
+    double const    *   y,
+    int                 n,
+    char const      *   title
+)
+{
+    int     i ;
+
+    if (handle==NULL || x==NULL || y==NULL || (n<1)) return ;
+    title = (title == NULL) ? "(none)" : title;
+
+    fprintf(handle->gnucmd, "%s '-' title \"%s\" with %s\n",
+            (handle->nplots > 0) ? "replot" : "plot", title, handle->pstyle) ;
+    for (i=0 ; i<n; i++) {
+        fprintf(handle->gnucmd, "%.10g %.10g\n", x[i], y[i]) ;
+    }
+    fputs("e\n", handle->gnucmd) ;
+    fflush(handle->gnucmd) ;
+
+    handle->nplots++ ;
+    return ;
+}
+
+
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Open a new session, plot a signal, close the session.
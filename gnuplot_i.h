@@ -259,6 +259,31 @@ void gnuplot_plot_xy(
 ) ;
 
 
+/*-------------------------------------------------------------------------*/
+/**
+  @brief    Plot a 2d graph from a list of points, sent inline down the pipe.
+  @param    handle      Gnuplot session control handle.
+  @param    x           Pointer to a list of x coordinates.
+  @param    y           Pointer to a list of y coordinates.
+  @param    n           Number of doubles in x (assumed the same as in y).
+  @param    title       Title of the plot.
+  @return   void
+
+  Same as gnuplot_plot_xy, but the points follow the plot command as
+  inline data ('-') instead of going through a temporary file, so
+  nothing touches the disk. Inline data is not kept by gnuplot: call
+  gnuplot_resetplot() before plotting again rather than replotting.
+ */
+/*--------------------------------------------------------------------------*/
+void gnuplot_plot_xy_inline(
+    gnuplot_ctrl    *   handle,
+    double const    *   x,
+    double const    *   y,
+    int                 n,
+    char const      *   title
+) ;
+
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Open a new session, plot a signal, close the session.
@@ -1,13 +1,75 @@
 #include "TSP.h"
 #include "AntColony.cpp"
+#include "Batch.cpp"
+#include <csignal>
 
+// Raised by Ctrl+C: the solver stops after the current iteration and writes its checkpoint
+CancellationToken interruption;
+
+/*
+    * Usage: AntColony -file <instance.tsp> [-flag value]...
+    *        AntColony -batch <directory or manifest> [-summary <file.csv>] [-flag value]...
+*/
 int main(int argc, char** argv) {
-    if (argc < 2) {
+    string mode = (argc > 1) ? argv[1] : "";
+    if (argc < 3 || (mode.compare("-file") != 0 && mode.compare("-batch") != 0)) {
         cout << "Please, insert file path!\n";
-        system("PAUSE");
+        cout << "Usage: " << argv[0] << " -file <instance.tsp> | -batch <directory or manifest> [-flag value]...\n";
+        return 1;
     }
     cout << "File: " << argv[2] << "\n";
-    AntColony algorithm(argv[2]);
+    SolverOptions options;
+    string progressPath, tourPath;
+    string summaryPath = "summary.csv";
+    for (int i = 3; i + 1 < argc; i += 2) {
+        string flag(argv[i]);
+        if (flag.compare("-init") == 0) options.initialTour = InitialTour::parseType(argv[i + 1]);
+        else if (flag.compare("-time") == 0) options.timeLimit = stod(argv[i + 1]);
+        else if (flag.compare("-reorder") == 0) options.reorder = parseCurve(argv[i + 1]);
+        else if (flag.compare("-trace") == 0) options.tracePath = argv[i + 1];
+        else if (flag.compare("-iterations") == 0) options.maxIterations = stoi(argv[i + 1]);
+        else if (flag.compare("-ants") == 0) options.ants = stoi(argv[i + 1]);
+        else if (flag.compare("-plot") == 0) options.plot = stoi(argv[i + 1]) != 0;
+        else if (flag.compare("-plotlimit") == 0) options.plotLimit = stoi(argv[i + 1]);
+        else if (flag.compare("-seed") == 0) options.seed = stoull(argv[i + 1]);
+        else if (flag.compare("-threads") == 0) options.threads = stoi(argv[i + 1]);
+        else if (flag.compare("-affinity") == 0) options.affinity = stoi(argv[i + 1]) != 0;
+        else if (flag.compare("-ls") == 0) options.localSearch = stoi(argv[i + 1]) != 0;
+        else if (flag.compare("-replicate") == 0) options.replicate = stoi(argv[i + 1]) != 0;
+        else if (flag.compare("-sparse") == 0) options.sparse = stoi(argv[i + 1]) != 0;
+        else if (flag.compare("-progress") == 0) progressPath = argv[i + 1];
+        else if (flag.compare("-tour") == 0) tourPath = argv[i + 1];
+        else if (flag.compare("-checkpoint") == 0) options.checkpointPath = argv[i + 1];
+        else if (flag.compare("-every") == 0) options.checkpointInterval = stoi(argv[i + 1]);
+        else if (flag.compare("-resume") == 0) options.resumePath = argv[i + 1];
+        else if (flag.compare("-summary") == 0) summaryPath = argv[i + 1];
+        else if (flag.compare("-precision") == 0) options.precision = parsePrecision(argv[i + 1]);
+        else if (flag.compare("-matrixfree") == 0) options.matrixFree = stoi(argv[i + 1]) != 0;
+        else if (flag.compare("-sampler") == 0) options.sampler = parseSampler(argv[i + 1]);
+        else if (flag.compare("-colony") == 0) options.colony = parseColonySize(argv[i + 1]);
+        else if (flag.compare("-restart") == 0) options.restart = stoi(argv[i + 1]) != 0;
+        else if (flag.compare("-bound") == 0) options.bound = parseBound(argv[i + 1]);
+        else if (flag.compare("-gap") == 0) options.gap = stod(argv[i + 1]);
+        else if (flag.compare("-candidates") == 0) options.candidates = parseCandidates(argv[i + 1]);
+    }
+    signal(SIGINT, [](int) { interruption.cancel(); });
+    if (mode.compare("-batch") == 0) {
+        ThreadPool::configure(options.threads, options.affinity);
+        BatchSolver batch(options);
+        batch.setCancellationToken(&interruption);
+        vector<string> files = BatchSolver::collect(argv[2]);
+        int solved = batch.run(files, summaryPath);
+        cout << solved << " of " << files.size() << " instances solved, summary in " << summaryPath << "\n";
+        return 0;
+    }
+    AntColony algorithm(argv[2], options);
+    unique_ptr<ProgressWriter> writer;
+    if (!progressPath.empty() || !tourPath.empty()) {
+        writer.reset(new ProgressWriter(progressPath, tourPath, algorithm.getName()));
+        algorithm.addObserver(writer.get());
+    }
+    algorithm.setCancellationToken(&interruption);
     algorithm.solve();
+    writer.reset();
     system("PAUSE");
-};
\ No newline at end of file
+};